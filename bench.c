@@ -0,0 +1,303 @@
+// bench.c - count.ko 핫패스 마이크로벤치마크 (하드웨어 없이 실행)
+//
+// 드라이버와 같은 헤더(pulse_classify.h, gpio_ring.h)를 사용하며,
+// 커널의 spin_lock_irqsave 자리에 pthread 스핀락을 둔다. 검증이 틀리거나
+// 주어진 임계값을 넘으면 실패로 끝나므로 make bench 를 회귀 검사로 쓸 수 있다.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sysprog_gpio.h"
+#include "pulse_classify.h"
+#include "gpio_ring.h"
+
+#define BENCH_EDGES      (1 << 22)
+#define BENCH_RING_OPS   (1 << 22)
+#define BENCH_BATCH      16
+#define MAX_READERS      16
+#define BENCH_CPUS       4          /* 모델 CPU 수 = 링 수 */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 입장/퇴장 펄스 엣지 분류 비용. 모든 펄스가 창 안에 있으므로 전부 분류돼야 한다.
+int bench_classifier(double max_ns) {
+    uint64_t *edges = malloc(BENCH_EDGES * sizeof(*edges));
+    struct pulse_classifier pc;
+    uint64_t ns = 1000000000ull;
+    unsigned long events = 0;
+    uint32_t width;
+
+    srand48(1);
+    for (size_t i = 0; i < BENCH_EDGES; i += 2) {
+        ns += 20000000ull;
+        edges[i] = ns;
+        ns += (drand48() < 0.5 ? 100000ull : 200000ull) * 1000 + (uint64_t)(drand48() * 10000000);
+        edges[i + 1] = ns;
+    }
+
+    pulse_classifier_init(&pc, edges[0]);
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < BENCH_EDGES; i++)
+        events += pulse_classify_edge(&pc, edges[i], !(i & 1), &width) > 0;
+    uint64_t elapsed = now_ns() - start;
+
+    double per_edge = (double)elapsed / BENCH_EDGES;
+    int failed = 0;
+
+    printf("classifier:        %6.1f ns/edge (%lu events)\n", per_edge, events);
+    free(edges);
+    if (events != BENCH_EDGES / 2) {
+        fprintf(stderr, "FAIL: classifier found %lu of %d pulses\n", events, BENCH_EDGES / 2);
+        failed = 1;
+    }
+    if (max_ns > 0 && per_edge > max_ns) {
+        fprintf(stderr, "FAIL: classifier %.1f ns/edge over %.1f\n", per_edge, max_ns);
+        failed = 1;
+    }
+    return failed;
+}
+
+// 단일 스레드 enqueue/dequeue 비용
+int bench_ring_single(double max_ns) {
+    static struct gpio_ring ring;
+    struct gpio_event ev = { .symbol = GPIO_SYM_ENTRY }, out[BENCH_BATCH];
+    uint32_t cursor = 0;
+    unsigned long got = 0;
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < BENCH_RING_OPS; i++)
+        gpio_ring_push(&ring, &ev);
+    uint64_t push_ns = now_ns() - start;
+
+    ring.head = 0;
+    start = now_ns();
+    for (int i = 0; i < BENCH_RING_OPS; i++) {
+        gpio_ring_push(&ring, &ev);
+        if ((i & (BENCH_BATCH - 1)) == BENCH_BATCH - 1)
+            got += gpio_ring_fetch(&ring, &cursor, out, BENCH_BATCH);
+    }
+    uint64_t both_ns = now_ns() - start;
+
+    double per_push = (double)push_ns / BENCH_RING_OPS;
+    int failed = 0;
+
+    printf("ring enqueue:      %6.1f ns/record\n", per_push);
+    printf("ring enq+deq/%d:   %6.1f ns/record (%lu dequeued)\n",
+           BENCH_BATCH, (double)both_ns / BENCH_RING_OPS, got);
+    if (got != BENCH_RING_OPS) {
+        fprintf(stderr, "FAIL: dequeued %lu of %d records\n", got, BENCH_RING_OPS);
+        failed = 1;
+    }
+    if (max_ns > 0 && per_push > max_ns) {
+        fprintf(stderr, "FAIL: ring enqueue %.1f ns/record over %.1f\n", per_push, max_ns);
+        failed = 1;
+    }
+    return failed;
+}
+
+// count.c 처럼 CPU 마다 링과 락을 하나씩 두고, seq 만 라인 전체가 공유한다
+struct cpu_ring {
+    pthread_spinlock_t lock;
+    struct gpio_ring ring;
+} __attribute__((aligned(64)));
+
+struct contention {
+    struct cpu_ring rings[BENCH_CPUS];
+    unsigned int seq;
+    volatile int done;
+};
+
+struct producer_arg {
+    struct contention *c;
+    int cpu;
+};
+
+struct reader_stat {
+    struct contention *c;
+    uint32_t cursors[BENCH_CPUS];
+    int taken[BENCH_CPUS];
+    struct gpio_event scratch[BENCH_CPUS][BENCH_BATCH + 1];
+    unsigned long records;
+    unsigned long lost;
+    unsigned long order_errors;
+};
+
+// 모델 CPU 하나에서 들어온 인터럽트 (gpio_event_push 와 같은 순서)
+static void *producer_thread(void *arg) {
+    struct producer_arg *p = arg;
+    struct cpu_ring *cr = &p->c->rings[p->cpu];
+    struct gpio_event ev = { .symbol = GPIO_SYM_ENTRY, .line = p->cpu };
+
+    for (int i = 0; i < BENCH_RING_OPS / BENCH_CPUS; i++) {
+        ev.ktime_ns = now_ns();
+        pthread_spin_lock(&cr->lock);
+        ev.seq = __atomic_fetch_add(&p->c->seq, 1, __ATOMIC_RELAXED);
+        gpio_ring_push(&cr->ring, &ev);
+        pthread_spin_unlock(&cr->lock);
+    }
+    return NULL;
+}
+
+// count.c gpio_event_fetch() 와 같은 병합: CPU 별로 최대 max 개를 떠 와서
+// 타임스탬프 순으로 합치고, 실제로 내보낸 만큼만 커서를 옮긴다.
+static int merge_fetch(struct reader_stat *st, struct gpio_event *out, int max) {
+    int n = 0;
+
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++) {
+        struct cpu_ring *cr = &st->c->rings[cpu];
+        uint32_t pos = st->cursors[cpu];
+
+        pthread_spin_lock(&cr->lock);
+        int k = gpio_ring_fetch(&cr->ring, &pos, st->scratch[cpu], max);
+        pthread_spin_unlock(&cr->lock);
+        st->lost += pos - k - st->cursors[cpu];
+        st->cursors[cpu] = pos - k;
+        st->taken[cpu] = 0;
+        st->scratch[cpu][k].ktime_ns = UINT64_MAX;
+    }
+
+    while (n < max) {
+        struct gpio_event *best = NULL;
+        int best_cpu = 0;
+
+        for (int cpu = 0; cpu < BENCH_CPUS; cpu++) {
+            struct gpio_event *ev = &st->scratch[cpu][st->taken[cpu]];
+            if (ev->ktime_ns != UINT64_MAX && (!best || ev->ktime_ns < best->ktime_ns)) {
+                best = ev;
+                best_cpu = cpu;
+            }
+        }
+        if (!best)
+            break;
+        out[n++] = *best;
+        st->taken[best_cpu]++;
+    }
+
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++)
+        st->cursors[cpu] += st->taken[cpu];
+    return n;
+}
+
+static int merge_pending(struct reader_stat *st) {
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++) {
+        if (gpio_ring_pending(&st->c->rings[cpu].ring, st->cursors[cpu]))
+            return 1;
+    }
+    return 0;
+}
+
+// 한 번에 떠 온 묶음은 타임스탬프 순이어야 하고, 같은 CPU 의 레코드는
+// seq 가 계속 늘어나야 한다.
+static void *reader_thread(void *arg) {
+    struct reader_stat *st = arg;
+    struct gpio_event out[BENCH_BATCH];
+    uint64_t last_ns[BENCH_CPUS] = { 0 };
+    int64_t last_seq[BENCH_CPUS];
+
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++)
+        last_seq[cpu] = -1;
+    while (!st->c->done || merge_pending(st)) {
+        int n = merge_fetch(st, out, BENCH_BATCH);
+        for (int i = 0; i < n; i++) {
+            int cpu = out[i].line;
+            if ((i && out[i].ktime_ns < out[i - 1].ktime_ns) ||
+                (int64_t)out[i].seq <= last_seq[cpu] || out[i].ktime_ns < last_ns[cpu])
+                st->order_errors++;
+            last_seq[cpu] = out[i].seq;
+            last_ns[cpu] = out[i].ktime_ns;
+        }
+        st->records += n;
+    }
+    return NULL;
+}
+
+// 생산자(CPU) BENCH_CPUS 개 + 리더 N 경합. 리더마다 읽은 것과 덮어써져
+// 놓친 것의 합이 생산량과 같아야 한다.
+int bench_ring_contention(int readers) {
+    static struct contention c;
+    static struct reader_stat st[MAX_READERS];
+    struct producer_arg prod[BENCH_CPUS];
+    pthread_t tid[MAX_READERS], ptid[BENCH_CPUS];
+    int failed = 0;
+
+    memset(&c, 0, sizeof(c));
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++)
+        pthread_spin_init(&c.rings[cpu].lock, PTHREAD_PROCESS_PRIVATE);
+    for (int r = 0; r < readers; r++) {
+        memset(&st[r], 0, sizeof(st[r]));
+        st[r].c = &c;
+        pthread_create(&tid[r], NULL, reader_thread, &st[r]);
+    }
+
+    uint64_t start = now_ns();
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++) {
+        prod[cpu] = (struct producer_arg){ .c = &c, .cpu = cpu };
+        pthread_create(&ptid[cpu], NULL, producer_thread, &prod[cpu]);
+    }
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++)
+        pthread_join(ptid[cpu], NULL);
+    uint64_t elapsed = now_ns() - start;
+    c.done = 1;
+
+    unsigned long records = 0, lost = 0, order_errors = 0;
+    for (int r = 0; r < readers; r++) {
+        pthread_join(tid[r], NULL);
+        records += st[r].records;
+        lost += st[r].lost;
+        order_errors += st[r].order_errors;
+        if (st[r].records + st[r].lost != (unsigned long)BENCH_RING_OPS) {
+            fprintf(stderr, "FAIL: reader %d accounted %lu of %d records\n",
+                    r, st[r].records + st[r].lost, BENCH_RING_OPS);
+            failed = 1;
+        }
+    }
+    for (int cpu = 0; cpu < BENCH_CPUS; cpu++)
+        pthread_spin_destroy(&c.rings[cpu].lock);
+    if (order_errors) {
+        fprintf(stderr, "FAIL: %lu records out of order with %d readers\n", order_errors, readers);
+        failed = 1;
+    }
+
+    printf("ring %dx%2d readers: %6.1f ns/enqueue, %lu records read, %lu overrun\n",
+           BENCH_CPUS, readers, (double)elapsed / BENCH_RING_OPS, records, lost);
+    return failed;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [readers] [-max-edge-ns N] [-max-enq-ns N]\n", prog);
+    exit(2);
+}
+
+// 임계값(ns)을 넘거나 검증이 틀리면 0 이 아닌 값으로 끝난다. 0 은 검사 안 함.
+int main(int argc, char *argv[]) {
+    int max_readers = 4, failed = 0;
+    double max_edge_ns = 0, max_enq_ns = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-max-edge-ns") == 0 && i + 1 < argc)
+            max_edge_ns = atof(argv[++i]);
+        else if (strcmp(argv[i], "-max-enq-ns") == 0 && i + 1 < argc)
+            max_enq_ns = atof(argv[++i]);
+        else if (argv[i][0] != '-')
+            max_readers = atoi(argv[i]);
+        else
+            usage(argv[0]);
+    }
+    if (max_readers < 1 || max_readers > MAX_READERS)
+        max_readers = 4;
+
+    failed |= bench_classifier(max_edge_ns);
+    failed |= bench_ring_single(max_enq_ns);
+    for (int r = 1; r <= max_readers; r *= 2)
+        failed |= bench_ring_contention(r);
+    if (failed)
+        fprintf(stderr, "gpio_bench: FAILED\n");
+    return failed;
+}
@@ -11,34 +11,146 @@
 #include <linux/signal.h>
 #include <linux/poll.h>
 #include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/kref.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/uio.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/hrtimer.h>
+#include <linux/completion.h>
+#include <linux/kfifo.h>
+#include <linux/version.h>
+
+#include "sysprog_gpio.h"
+#include "pulse_classify.h"
+#include "gpio_ring.h"
+#include "link_frame.h"
+#include "manchester.h"
 
 #define CLASS_NAME "sysprog_gpio"
 #define MAX_GPIO 10
 #define GPIOCHIP_BASE 512
 
-#define GPIO_IOCTL_MAGIC       'G'
-#define GPIO_IOCTL_ENABLE_IRQ  _IOW(GPIO_IOCTL_MAGIC, 1, int)
-#define GPIO_IOCTL_DISABLE_IRQ _IOW(GPIO_IOCTL_MAGIC, 2, int)
-#define GPIO_IOCTL_GET_COUNT   _IOR(GPIO_IOCTL_MAGIC, 3, int)
+#define GPIO_READ_CHUNK      16
+#define GPIO_RX_FRAMES       16     /* queued DATA frames per line, power of two */
+
+enum gpio_encoding {
+    GPIO_ENC_PULSE,                 /* width-coded pulses (pulse_classify.h) */
+    GPIO_ENC_MANCHESTER,            /* link frames (manchester.h) */
+};
+
+// Needs 6.4 or later (one-argument class_create(), const class attribute
+// callbacks). hrtimer_setup() only arrived in 6.13, so older kernels such
+// as the 6.6 and 6.12 LTS ones set the callback by hand.
+static inline void gpio_hrtimer_setup(struct hrtimer *timer,
+                                      enum hrtimer_restart (*fn)(struct hrtimer *),
+                                      clockid_t clock_id, enum hrtimer_mode mode) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+    hrtimer_setup(timer, fn, clock_id, mode);
+#else
+    hrtimer_init(timer, clock_id, mode);
+    timer->function = fn;
+#endif
+}
 
 static dev_t dev_num_base;
 static struct cdev gpio_cdev;
 static int major_num;
 
 struct gpio_entry {
+    struct kref ref;                /* table slot + one per open file */
+    bool gone;                      /* unexported, readers see EOF */
     int bcm_num;
     struct gpio_desc *desc;
     struct device *dev;
+    struct mutex irq_lock;          /* IRQ ownership: enable, disable, affinity */
     int irq_num;
     bool irq_enabled;
+    int irq_users;                  /* files holding the IRQ on */
+    int irq_cpu;                    /* affinity hint, -1 for default */
     struct fasync_struct *async_queue;
-    ktime_t last_time;
+    struct pulse_classifier classifier;
+    bool capture;                   /* also log every raw edge */
+
+    wait_queue_head_t ring_wait;
+    atomic_t seq;                   /* per-line record sequence */
+    struct gpio_cpu_ring __percpu *rings;
+
+    struct mutex la_lock;           /* logic-analyzer buffer setup */
+    bool la_active;
+    struct file *la_owner;
+    void *la_buf;                   /* vmalloc_user: ctrl page + edge slots */
+    size_t la_size;
+    struct gpio_la_ctrl *la_ctrl;
+    struct gpio_la_edge *la_edges;
+    atomic_t la_maps;
+
+    int encoding;                   /* enum gpio_encoding */
+    u32 bitrate;
+    struct manch_decoder manch;     /* IRQ handler only */
+    DECLARE_KFIFO(rx_frames, struct gpio_link_frame, GPIO_RX_FRAMES);
+    spinlock_t rx_frames_lock;      /* serialises consumers */
+    u32 rx_dropped;
+    bool delta_synced;              /* delta_next is valid */
+    u16 delta_next;                 /* expected DELTA batch seq */
+    u32 seq_gaps;                   /* DELTA batches missed */
+    struct mutex tx_lock;           /* one frame on the wire at a time */
+    struct hrtimer tx_timer;
+    struct completion tx_done;
+    ktime_t tx_half;
+    int tx_pos, tx_len;
+    u8 tx_halves[MANCH_MAX_HALVES];
+};
+
+// Events are buffered on the CPU that took the interrupt and merged by
+// timestamp on read, so producers on different CPUs never contend for a
+// ring lock or write the same records. The per-line seq counter and
+// ring_wait are still shared and bounce between them on every push.
+struct gpio_cpu_ring {
+    spinlock_t lock;
+    struct gpio_ring ring;
+};
+
+struct gpio_reader {
+    struct mutex lock;              /* serialises reads on this file */
+    struct gpio_entry *entry;
+    u32 *cursors;                   /* per-CPU ring position, nr_cpu_ids */
+    int *taken;                     /* per-CPU records merged this fetch */
+    struct gpio_event *scratch;     /* GPIO_READ_CHUNK + 1 per CPU */
+    bool irq_held;                  /* this file counts in irq_users */
 };
 
 static struct class *gpiod_class;
 static struct gpio_entry *gpio_table[MAX_GPIO];
+static DEFINE_MUTEX(gpio_table_lock);
 static atomic_t people_count = ATOMIC_INIT(0);
 
+static unsigned int calib_max_shift_us = PULSE_CALIB_MAX_SHIFT_US;
+
+// Larger shifts would let the entry and exit windows overlap.
+static int calib_max_shift_set(const char *val, const struct kernel_param *kp) {
+    unsigned int us;
+    int ret = kstrtouint(val, 0, &us);
+
+    if (ret)
+        return ret;
+    if (us > PULSE_CALIB_MAX_SHIFT_US)
+        return -EINVAL;
+    return param_set_uint(val, kp);
+}
+
+static const struct kernel_param_ops calib_max_shift_ops = {
+    .set = calib_max_shift_set,
+    .get = param_get_uint,
+};
+module_param_cb(calib_max_shift_us, &calib_max_shift_ops, &calib_max_shift_us, 0444);
+MODULE_PARM_DESC(calib_max_shift_us, "Max distance an auto-calibrated window may move from nominal (us, <= " __stringify(PULSE_CALIB_MAX_SHIFT_US) ")");
+
 // ---- SYSFS ATTRIBUTES ----
 
 static ssize_t value_show(struct device *dev, struct device_attribute *attr, char *buf) {
@@ -70,30 +182,519 @@ static ssize_t direction_store(struct device *dev, struct device_attribute *attr
     return count;
 }
 
+static ssize_t capture_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(entry->capture));
+}
+
+static ssize_t capture_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    bool on;
+    if (kstrtobool(buf, &on)) return -EINVAL;
+    WRITE_ONCE(entry->capture, on);
+    return count;
+}
+
+// Calibration state is updated from the IRQ handler without a lock; a
+// reader may see a window mid-update, which is harmless for display.
+static ssize_t calibrate_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(entry->classifier.calib.enabled));
+}
+
+// Writing 0 stops adapting and forgets the calibration. The handler is
+// kept out meanwhile so it cannot step on the state being reset.
+static ssize_t calibrate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    bool on;
+    if (kstrtobool(buf, &on)) return -EINVAL;
+    mutex_lock(&entry->irq_lock);
+    if (entry->irq_enabled)
+        disable_irq(entry->irq_num);
+    WRITE_ONCE(entry->classifier.calib.enabled, on);
+    if (!on)
+        pulse_calib_reset(&entry->classifier);
+    if (entry->irq_enabled)
+        enable_irq(entry->irq_num);
+    mutex_unlock(&entry->irq_lock);
+    return count;
+}
+
+static ssize_t windows_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    struct pulse_classifier *pc = &entry->classifier;
+    return scnprintf(buf, PAGE_SIZE, "entry %u %u\nexit %u %u\n",
+                     READ_ONCE(pc->entry.lo_us), READ_ONCE(pc->entry.hi_us),
+                     READ_ONCE(pc->exit.lo_us), READ_ONCE(pc->exit.hi_us));
+}
+
+// Rejected falling edges per million classified since export.
+static ssize_t reject_rate_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%u\n", pulse_reject_ppm(&entry->classifier));
+}
+
+static ssize_t irq_cpu_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(entry->irq_cpu));
+}
+
+// Steers the line's IRQ to one CPU (-1 restores the default affinity).
+// Applied now if the IRQ is live, otherwise when it is next enabled.
+static ssize_t irq_cpu_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    int cpu, ret = 0;
+    if (kstrtoint(buf, 10, &cpu)) return -EINVAL;
+    if (cpu >= 0 && (cpu >= nr_cpu_ids || !cpu_online(cpu))) return -EINVAL;
+    if (cpu < 0) cpu = -1;
+    mutex_lock(&entry->irq_lock);
+    if (entry->irq_enabled) {
+        if (cpu >= 0)
+            ret = irq_set_affinity_and_hint(entry->irq_num, cpumask_of(cpu));
+        else if (!(ret = irq_update_affinity_hint(entry->irq_num, NULL)))
+            ret = irq_set_affinity(entry->irq_num, cpu_online_mask);
+    }
+    if (!ret)
+        WRITE_ONCE(entry->irq_cpu, cpu);
+    mutex_unlock(&entry->irq_lock);
+    return ret ? ret : count;
+}
+
+static ssize_t encoding_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%s\n",
+                     READ_ONCE(entry->encoding) == GPIO_ENC_MANCHESTER ? "manchester" : "pulse");
+}
+
+// The IRQ handler decodes without a lock, so the line code and bitrate
+// only change while the IRQ is off and no frame is being sent. ENABLE_IRQ
+// also takes tx_lock, so the IRQ cannot come on between check and update.
+static ssize_t encoding_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    int enc, ret = count;
+    if (sysfs_streq(buf, "pulse")) enc = GPIO_ENC_PULSE;
+    else if (sysfs_streq(buf, "manchester")) enc = GPIO_ENC_MANCHESTER;
+    else return -EINVAL;
+    mutex_lock(&entry->tx_lock);
+    if (entry->irq_enabled) {
+        ret = -EBUSY;
+    } else {
+        manch_decoder_init(&entry->manch, entry->bitrate);
+        WRITE_ONCE(entry->encoding, enc);
+    }
+    mutex_unlock(&entry->tx_lock);
+    return ret;
+}
+
+static ssize_t bitrate_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(entry->bitrate));
+}
+
+static ssize_t bitrate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    u32 rate;
+    int ret = count;
+    if (kstrtou32(buf, 10, &rate)) return -EINVAL;
+    if (rate < MANCH_MIN_BITRATE || rate > MANCH_MAX_BITRATE) return -EINVAL;
+    mutex_lock(&entry->tx_lock);
+    if (entry->irq_enabled) {
+        ret = -EBUSY;
+    } else {
+        WRITE_ONCE(entry->bitrate, rate);
+        manch_decoder_init(&entry->manch, rate);
+    }
+    mutex_unlock(&entry->tx_lock);
+    return ret;
+}
+
+// Receive-side link counters since the encoding was last set.
+static ssize_t link_stats_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    struct manch_decoder *d = &entry->manch;
+    return scnprintf(buf, PAGE_SIZE, "frames %u\ncrc_errors %u\ncode_errors %u\nrx_dropped %u\n",
+                     READ_ONCE(d->rx.frames), READ_ONCE(d->rx.crc_errors),
+                     READ_ONCE(d->code_errors), READ_ONCE(entry->rx_dropped));
+}
+
+// DELTA batches lost on the link, from gaps in the batch sequence.
+static ssize_t seq_gaps_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct gpio_entry *entry = dev_get_drvdata(dev);
+    return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(entry->seq_gaps));
+}
+
 static DEVICE_ATTR_RW(value);
 static DEVICE_ATTR_RW(direction);
+static DEVICE_ATTR_RW(capture);
+static DEVICE_ATTR_RW(calibrate);
+static DEVICE_ATTR_RO(windows);
+static DEVICE_ATTR_RO(reject_rate);
+static DEVICE_ATTR_RW(irq_cpu);
+static DEVICE_ATTR_RW(encoding);
+static DEVICE_ATTR_RW(bitrate);
+static DEVICE_ATTR_RO(link_stats);
+static DEVICE_ATTR_RO(seq_gaps);
+
+// Created together with the device, so every attribute exists before the
+// KOBJ_ADD uevent goes out and before the export write returns.
+static struct attribute *gpio_attrs[] = {
+    &dev_attr_value.attr,
+    &dev_attr_direction.attr,
+    &dev_attr_capture.attr,
+    &dev_attr_calibrate.attr,
+    &dev_attr_windows.attr,
+    &dev_attr_reject_rate.attr,
+    &dev_attr_irq_cpu.attr,
+    &dev_attr_encoding.attr,
+    &dev_attr_bitrate.attr,
+    &dev_attr_link_stats.attr,
+    &dev_attr_seq_gaps.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(gpio);
+
+// ---- ENTRY LIFETIME ----
+
+static void gpio_entry_release(struct kref *ref) {
+    struct gpio_entry *entry = container_of(ref, struct gpio_entry, ref);
+
+    hrtimer_cancel(&entry->tx_timer);
+    vfree(entry->la_buf);
+    free_percpu(entry->rings);
+    kfree(entry);
+}
+
+static void gpio_entry_put(struct gpio_entry *entry) {
+    kref_put(&entry->ref, gpio_entry_release);
+}
+
+// Drops the table's reference. Open files keep the entry alive until
+// release; blocked readers are woken and see EOF.
+static void gpio_entry_remove(int minor) {
+    struct gpio_entry *entry = gpio_table[minor];
+
+    gpio_table[minor] = NULL;
+    device_destroy(gpiod_class, MKDEV(major_num, minor));
+    WRITE_ONCE(entry->gone, true);
+    wake_up_interruptible(&entry->ring_wait);
+    gpio_entry_put(entry);
+}
+
+// ---- EVENT RING ----
+
+static void gpio_event_push(struct gpio_entry *entry, ktime_t now, u32 width_us,
+                            u8 symbol, int count_after, u8 ev_flags) {
+    struct gpio_event ev = {
+        .ktime_ns = ktime_to_ns(now),
+        .count_after = count_after,
+        .width_us = width_us,
+        .line = entry->bcm_num,
+        .symbol = symbol,
+        .flags = ev_flags,
+    };
+    struct gpio_cpu_ring *cr;
+    unsigned long flags;
+
+    local_irq_save(flags);
+    cr = this_cpu_ptr(entry->rings);
+    spin_lock(&cr->lock);
+    ev.seq = atomic_inc_return(&entry->seq) - 1;
+    gpio_ring_push(&cr->ring, &ev);
+    spin_unlock(&cr->lock);
+    local_irq_restore(flags);
+
+    wake_up_interruptible(&entry->ring_wait);
+}
+
+// Takes up to max records from every CPU's ring into the scratch area,
+// merges them by timestamp into out and only advances each cursor past
+// the records that were actually returned.
+static int gpio_event_fetch(struct gpio_reader *reader, struct gpio_event *out, int max) {
+    struct gpio_entry *entry = reader->entry;
+    unsigned long flags;
+    int cpu, n = 0;
+
+    for_each_possible_cpu(cpu) {
+        struct gpio_cpu_ring *cr = per_cpu_ptr(entry->rings, cpu);
+        struct gpio_event *dst = reader->scratch + cpu * (GPIO_READ_CHUNK + 1);
+        u32 pos = reader->cursors[cpu];
+        int k;
+
+        spin_lock_irqsave(&cr->lock, flags);
+        k = gpio_ring_fetch(&cr->ring, &pos, dst, max);
+        spin_unlock_irqrestore(&cr->lock, flags);
+        reader->cursors[cpu] = pos - k;     /* keeps any overrun skip */
+        reader->taken[cpu] = 0;
+        dst[k].ktime_ns = U64_MAX;          /* end-of-run sentinel */
+    }
+
+    while (n < max) {
+        struct gpio_event *best = NULL;
+        int best_cpu = 0;
+
+        for_each_possible_cpu(cpu) {
+            struct gpio_event *ev = reader->scratch + cpu * (GPIO_READ_CHUNK + 1) + reader->taken[cpu];
+            if (ev->ktime_ns != U64_MAX && (!best || ev->ktime_ns < best->ktime_ns)) {
+                best = ev;
+                best_cpu = cpu;
+            }
+        }
+        if (!best)
+            break;
+        out[n++] = *best;
+        reader->taken[best_cpu]++;
+    }
+
+    for_each_possible_cpu(cpu)
+        reader->cursors[cpu] += reader->taken[cpu];
+    return n;
+}
+
+static bool gpio_event_pending(struct gpio_reader *reader) {
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        if (gpio_ring_pending(&per_cpu_ptr(reader->entry->rings, cpu)->ring, reader->cursors[cpu]))
+            return true;
+    }
+    return false;
+}
+
+// ---- LOGIC-ANALYZER CAPTURE ----
+
+// Single producer per line (the IRQ handler is not reentrant), so the slot
+// is filled first and head published with release semantics.
+static void gpio_la_record(struct gpio_entry *entry, u64 ktime_ns, int level) {
+    struct gpio_la_ctrl *ctrl = entry->la_ctrl;
+    u32 head = ctrl->head;
+    struct gpio_la_edge *e = &entry->la_edges[head & (ctrl->capacity - 1)];
+
+    e->ktime_ns = ktime_ns;
+    e->level = level;
+    smp_store_release(&ctrl->head, head + 1);
+}
+
+// Called with la_lock held; once it returns no handler is still recording.
+static void gpio_la_stop(struct gpio_entry *entry) {
+    WRITE_ONCE(entry->la_active, false);
+    mutex_lock(&entry->irq_lock);
+    if (entry->irq_enabled)
+        synchronize_irq(entry->irq_num);
+    mutex_unlock(&entry->irq_lock);
+    entry->la_owner = NULL;
+}
+
+static int gpio_la_start(struct gpio_entry *entry, struct file *filp, u32 slots) {
+    size_t size;
+    int ret = 0;
+
+    if (slots < GPIO_LA_MIN_SLOTS || slots > GPIO_LA_MAX_SLOTS || !is_power_of_2(slots))
+        return -EINVAL;
+    size = PAGE_ALIGN(PAGE_SIZE + (size_t)slots * sizeof(struct gpio_la_edge));
+
+    mutex_lock(&entry->la_lock);
+    if (entry->la_active) {
+        ret = -EBUSY;
+        goto out;
+    }
+    // A buffer of a different size can only be replaced once unmapped.
+    if (entry->la_buf && entry->la_ctrl->capacity != slots) {
+        if (atomic_read(&entry->la_maps)) {
+            ret = -EBUSY;
+            goto out;
+        }
+        vfree(entry->la_buf);
+        entry->la_buf = NULL;
+    }
+    if (!entry->la_buf) {
+        entry->la_buf = vmalloc_user(size);
+        if (!entry->la_buf) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        entry->la_size = size;
+        entry->la_ctrl = entry->la_buf;
+        entry->la_edges = entry->la_buf + PAGE_SIZE;
+        entry->la_ctrl->hdr.magic = GPIO_LA_MAGIC;
+        entry->la_ctrl->hdr.version = GPIO_LA_VERSION;
+        entry->la_ctrl->hdr.record_size = sizeof(struct gpio_la_edge);
+        entry->la_ctrl->capacity = slots;
+        entry->la_ctrl->line = entry->bcm_num;
+    }
+    WRITE_ONCE(entry->la_ctrl->head, 0);
+    entry->la_owner = filp;
+    // Publishes la_ctrl, la_edges and the reset head to the handler.
+    smp_store_release(&entry->la_active, true);
+out:
+    mutex_unlock(&entry->la_lock);
+    return ret;
+}
+
+static void gpio_la_vm_open(struct vm_area_struct *vma) {
+    struct gpio_entry *entry = vma->vm_private_data;
+    atomic_inc(&entry->la_maps);
+}
+
+static void gpio_la_vm_close(struct vm_area_struct *vma) {
+    struct gpio_entry *entry = vma->vm_private_data;
+    atomic_dec(&entry->la_maps);
+}
+
+static const struct vm_operations_struct gpio_la_vm_ops = {
+    .open = gpio_la_vm_open,
+    .close = gpio_la_vm_close,
+};
+
+// ---- MANCHESTER TRANSMIT ----
+
+// One half-bit per expiry on absolute deadlines, so a late expiry shortens
+// the next half instead of shifting the rest of the frame. The frame only
+// completes one expiry after the last half is set, so the trailing idle gap
+// is held in full before the next frame can start.
+static enum hrtimer_restart gpio_tx_timer_fn(struct hrtimer *timer) {
+    struct gpio_entry *entry = container_of(timer, struct gpio_entry, tx_timer);
+
+    if (entry->tx_pos == entry->tx_len) {
+        complete(&entry->tx_done);
+        return HRTIMER_NORESTART;
+    }
+    gpiod_set_value(entry->desc, entry->tx_halves[entry->tx_pos++]);
+    hrtimer_add_expires(timer, entry->tx_half);
+    return HRTIMER_RESTART;
+}
+
+static int gpio_link_tx(struct gpio_entry *entry, const struct gpio_link_frame *f) {
+    u8 bytes[LINK_MAX_FRAME];
+    int n, ret;
+
+    if (READ_ONCE(entry->encoding) != GPIO_ENC_MANCHESTER)
+        return -EINVAL;
+    if (gpiod_get_direction(entry->desc))
+        return -EPERM;
+    if (gpiod_cansleep(entry->desc))
+        return -EOPNOTSUPP;
+    n = link_frame_encode(bytes, f->type, f->seq, f->payload, f->len);
+    if (n < 0)
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&entry->tx_lock))
+        return -ERESTARTSYS;
+    // encoding_store() may have switched the line back while we waited.
+    if (entry->encoding != GPIO_ENC_MANCHESTER) {
+        mutex_unlock(&entry->tx_lock);
+        return -EINVAL;
+    }
+    entry->tx_len = manch_encode(entry->tx_halves, bytes, n);
+    entry->tx_pos = 0;
+    entry->tx_half = ns_to_ktime(manch_half_ns(entry->bitrate));
+    reinit_completion(&entry->tx_done);
+    hrtimer_start(&entry->tx_timer, ktime_get(), HRTIMER_MODE_ABS_HARD);
+
+    ret = wait_for_completion_interruptible(&entry->tx_done);
+    if (ret) {
+        // Abandoned mid-frame: the receiver drops it on the CRC.
+        hrtimer_cancel(&entry->tx_timer);
+        gpiod_set_value(entry->desc, 0);
+    }
+    mutex_unlock(&entry->tx_lock);
+    return ret;
+}
 
 // ---- IRQ HANDLER ----
 
+// Applies one ENTRY/EXIT, whether it came from a pulse or a link frame.
+static void gpio_count_event(struct gpio_entry *entry, ktime_t now, u32 width_us, int sym) {
+    int count;
+
+    if (sym == GPIO_SYM_EXIT) {
+        count = atomic_dec_return(&people_count);
+        gpio_event_push(entry, now, width_us, GPIO_SYM_EXIT, count, 0);
+        pr_debug("[PeopleCounter] Detected EXIT (delta: %u us), count: %d\n", width_us, count);
+    } else if (sym == GPIO_SYM_ENTRY) {
+        count = atomic_inc_return(&people_count);
+        gpio_event_push(entry, now, width_us, GPIO_SYM_ENTRY, count, 0);
+        pr_debug("[PeopleCounter] Detected ENTRY (delta: %u us), count: %d\n", width_us, count);
+    }
+}
+
+// Applies a whole batch with one atomic update, so readers never see it
+// half applied. The first batch after export only sets the sequence, and
+// a backwards jump is taken as a transmitter restart rather than a gap.
+static void gpio_count_delta(struct gpio_entry *entry, ktime_t now, const u8 *payload) {
+    u16 batch, missed;
+    s16 entries, exits;
+    u8 ev_flags = 0;
+    int count;
+
+    link_delta_decode(payload, &batch, &entries, &exits);
+    missed = batch - entry->delta_next;
+    if (entry->delta_synced && missed && missed < 0x8000) {
+        WRITE_ONCE(entry->seq_gaps, entry->seq_gaps + missed);
+        ev_flags |= GPIO_EV_SEQ_GAP;
+        pr_warn_ratelimited("[PeopleCounter] Missed %u delta batches before %u\n", missed, batch);
+    }
+    entry->delta_synced = true;
+    entry->delta_next = batch + 1;
+
+    count = atomic_add_return(entries - exits, &people_count);
+    gpio_event_push(entry, now, (u16)entries | (u32)(u16)exits << 16, GPIO_SYM_DELTA, count, ev_flags);
+    pr_debug("[PeopleCounter] Delta batch %u: +%d -%d, count: %d\n", batch, entries, exits, count);
+}
+
+// Called from the IRQ handler with a complete, CRC-checked frame.
+static void gpio_link_deliver(struct gpio_entry *entry, ktime_t now) {
+    const struct link_rx *rx = &entry->manch.rx;
+    struct gpio_link_frame f;
+
+    BUILD_BUG_ON(sizeof(f.payload) < LINK_MAX_PAYLOAD);
+    switch (link_rx_type(rx)) {
+    case LINK_FRAME_EVENT:
+        if (link_rx_len(rx) == 1)
+            gpio_count_event(entry, now, 0, link_rx_payload(rx)[0]);
+        break;
+    case LINK_FRAME_DELTA:
+        if (link_rx_len(rx) == LINK_DELTA_LEN)
+            gpio_count_delta(entry, now, link_rx_payload(rx));
+        break;
+    case LINK_FRAME_DATA:
+        f.type = link_rx_type(rx);
+        f.seq = link_rx_seq(rx);
+        f.len = link_rx_len(rx);
+        f.reserved = 0;
+        memcpy(f.payload, link_rx_payload(rx), f.len);
+        if (!kfifo_put(&entry->rx_frames, f))
+            WRITE_ONCE(entry->rx_dropped, entry->rx_dropped + 1);
+        gpio_event_push(entry, now, f.len, GPIO_SYM_FRAME, atomic_read(&people_count), f.type);
+        break;
+    }
+}
+
 static irqreturn_t gpio_irq_handler(int irq, void *dev_id) {
     struct gpio_entry *entry = dev_id;
     ktime_t now = ktime_get();
-    s64 delta_us = ktime_to_us(ktime_sub(now, entry->last_time));
-    entry->last_time = now;
-
     int val = gpiod_get_value(entry->desc);
-    if (val == 0) {
-        if (delta_us > 180000 && delta_us < 220000) {
-            atomic_dec(&people_count);
-            pr_info("[PeopleCounter] Detected EXIT (delta: %lld us), count: %d\n", delta_us, atomic_read(&people_count));
-        } else if (delta_us > 80000 && delta_us < 120000) {
-            atomic_inc(&people_count);
-            pr_info("[PeopleCounter] Detected ENTRY (delta: %lld us), count: %d\n", delta_us, atomic_read(&people_count));
-        } else {
-            pr_info("[PeopleCounter] Ignored pulse (delta: %lld us)\n", delta_us);
-        }
+    u32 width_us = 0;
+    int sym = GPIO_SYM_NONE;
+
+    if (READ_ONCE(entry->encoding) == GPIO_ENC_MANCHESTER) {
+        width_us = (u32)div_u64(ktime_to_ns(now) - entry->manch.last_ns, 1000);
+        if (manch_decode_edge(&entry->manch, ktime_to_ns(now), val) == LINK_RX_FRAME)
+            gpio_link_deliver(entry, now);
+    } else {
+        sym = pulse_classify_edge(&entry->classifier, ktime_to_ns(now), val, &width_us);
     }
 
+    if (smp_load_acquire(&entry->la_active))
+        gpio_la_record(entry, ktime_to_ns(now), val);
+
+    if (READ_ONCE(entry->capture))
+        gpio_event_push(entry, now, width_us, GPIO_SYM_EDGE, atomic_read(&people_count), val);
+
+    if (sym == PULSE_REJECTED)
+        pr_debug("[PeopleCounter] Ignored pulse (delta: %u us)\n", width_us);
+    else
+        gpio_count_event(entry, now, width_us, sym);
+
     if (entry->async_queue)
         kill_fasync(&entry->async_queue, SIGIO, POLL_IN);
 
@@ -102,55 +703,173 @@ static irqreturn_t gpio_irq_handler(int irq, void *dev_id) {
 
 // ---- FILE OPERATIONS ----
 
+static void gpio_reader_free(struct gpio_reader *reader) {
+    kfree(reader->scratch);
+    kfree(reader->taken);
+    kfree(reader->cursors);
+    kfree(reader);
+}
+
+// Clears the affinity hint first; free_irq() warns if one is still set.
+static void gpio_irq_release(struct gpio_entry *entry) {
+    irq_update_affinity_hint(entry->irq_num, NULL);
+    free_irq(entry->irq_num, entry);
+    entry->irq_enabled = false;
+}
+
+// Called with irq_lock held. Each file holds at most one reference; the
+// first requests the IRQ and the last one dropped frees it, so rx and la
+// can share a line and start or stop in any order.
+static int gpio_irq_get(struct gpio_entry *entry, struct gpio_reader *reader) {
+    int irq, ret;
+
+    if (reader->irq_held)
+        return -EBUSY;
+    if (entry->irq_enabled)
+        goto hold;
+    irq = gpiod_to_irq(entry->desc);
+    if (irq < 0) return -EINVAL;
+    if (request_irq(irq, gpio_irq_handler,
+                    IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+                    "gpio_irq", entry)) {
+        pr_err("[sysprog_gpio] IRQ request failed\n");
+        return -EIO;
+    }
+    entry->irq_num = irq;
+    entry->irq_enabled = true;
+    if (entry->irq_cpu >= 0) {
+        ret = irq_set_affinity_and_hint(irq, cpumask_of(entry->irq_cpu));
+        if (ret) {
+            pr_err("[sysprog_gpio] Cannot steer IRQ %d to CPU %d\n", irq, entry->irq_cpu);
+            gpio_irq_release(entry);
+            return ret;
+        }
+    }
+    pulse_classifier_restart(&entry->classifier, ktime_get_ns());
+hold:
+    entry->irq_users++;
+    reader->irq_held = true;
+    return 0;
+}
+
+// Called with irq_lock held.
+static void gpio_irq_put(struct gpio_entry *entry, struct gpio_reader *reader) {
+    reader->irq_held = false;
+    if (--entry->irq_users == 0)
+        gpio_irq_release(entry);
+}
+
 static int gpio_fops_open(struct inode *inode, struct file *filp) {
     int minor = iminor(inode);
-    if (minor >= MAX_GPIO || !gpio_table[minor])
+    struct gpio_reader *reader;
+    int cpu;
+
+    if (minor >= MAX_GPIO)
+        return -ENODEV;
+
+    reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+    if (!reader)
+        return -ENOMEM;
+    reader->cursors = kcalloc(nr_cpu_ids, sizeof(*reader->cursors), GFP_KERNEL);
+    reader->taken = kcalloc(nr_cpu_ids, sizeof(*reader->taken), GFP_KERNEL);
+    reader->scratch = kcalloc(nr_cpu_ids * (GPIO_READ_CHUNK + 1), sizeof(*reader->scratch), GFP_KERNEL);
+    if (!reader->cursors || !reader->taken || !reader->scratch) {
+        gpio_reader_free(reader);
+        return -ENOMEM;
+    }
+
+    mutex_lock(&gpio_table_lock);
+    reader->entry = gpio_table[minor];
+    if (reader->entry)
+        kref_get(&reader->entry->ref);
+    mutex_unlock(&gpio_table_lock);
+    if (!reader->entry) {
+        gpio_reader_free(reader);
         return -ENODEV;
-    filp->private_data = gpio_table[minor];
+    }
+    for_each_possible_cpu(cpu)
+        reader->cursors[cpu] = gpio_ring_head(&per_cpu_ptr(reader->entry->rings, cpu)->ring);
+    mutex_init(&reader->lock);
+    filp->private_data = reader;
+    filp->f_mode |= FMODE_NOWAIT;
     return 0;
 }
 
 static int gpio_fops_release(struct inode *inode, struct file *filp) {
-    struct gpio_entry *entry = filp->private_data;
-    if (entry && entry->irq_enabled) {
-        free_irq(entry->irq_num, entry);
-        entry->irq_enabled = false;
-    }
+    struct gpio_reader *reader = filp->private_data;
+    struct gpio_entry *entry = reader->entry;
+    mutex_lock(&entry->la_lock);
+    if (entry->la_owner == filp)
+        gpio_la_stop(entry);
+    mutex_unlock(&entry->la_lock);
+    mutex_lock(&entry->irq_lock);
+    if (reader->irq_held)
+        gpio_irq_put(entry, reader);
+    mutex_unlock(&entry->irq_lock);
     fasync_helper(-1, filp, 0, &entry->async_queue);
+    gpio_entry_put(entry);
+    gpio_reader_free(reader);
     return 0;
 }
 
 static int gpio_fops_fasync(int fd, struct file *filp, int mode) {
-    struct gpio_entry *entry = filp->private_data;
-    return fasync_helper(fd, filp, mode, &entry->async_queue);
+    struct gpio_reader *reader = filp->private_data;
+    return fasync_helper(fd, filp, mode, &reader->entry->async_queue);
 }
 
 static long gpio_fops_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
-    struct gpio_entry *entry = filp->private_data;
-    int irq;
+    struct gpio_reader *reader = filp->private_data;
+    struct gpio_entry *entry = reader->entry;
+    int ret;
 
     switch (cmd) {
     case GPIO_IOCTL_ENABLE_IRQ:
-        if (entry->irq_enabled)
-            return -EBUSY;
-        irq = gpiod_to_irq(entry->desc);
-        if (irq < 0) return -EINVAL;
-        if (request_irq(irq, gpio_irq_handler,
-                        IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
-                        "gpio_irq", entry)) {
-            pr_err("[sysprog_gpio] IRQ request failed\n");
-            return -EIO;
+        // Lock order: irq_lock, then tx_lock (see encoding_store()).
+        mutex_lock(&entry->irq_lock);
+        if (mutex_lock_interruptible(&entry->tx_lock)) {
+            mutex_unlock(&entry->irq_lock);
+            return -ERESTARTSYS;
         }
-        entry->irq_num = irq;
-        entry->irq_enabled = true;
-        entry->last_time = ktime_get();
-        return 0;
+        ret = gpio_irq_get(entry, reader);
+        mutex_unlock(&entry->tx_lock);
+        mutex_unlock(&entry->irq_lock);
+        return ret;
     case GPIO_IOCTL_DISABLE_IRQ:
-        if (!entry->irq_enabled)
-            return -EINVAL;
-        free_irq(entry->irq_num, entry);
-        entry->irq_enabled = false;
+        // Only drops this file's own reference.
+        mutex_lock(&entry->irq_lock);
+        ret = reader->irq_held ? 0 : -EINVAL;
+        if (!ret)
+            gpio_irq_put(entry, reader);
+        mutex_unlock(&entry->irq_lock);
+        return ret;
+    case GPIO_IOCTL_LA_START:
+        {
+            u32 slots;
+            if (copy_from_user(&slots, (u32 __user *)arg, sizeof(slots)))
+                return -EFAULT;
+            return gpio_la_start(entry, filp, slots);
+        }
+    case GPIO_IOCTL_LA_STOP:
+        mutex_lock(&entry->la_lock);
+        gpio_la_stop(entry);
+        mutex_unlock(&entry->la_lock);
         return 0;
+    case GPIO_IOCTL_TX_FRAME:
+        {
+            struct gpio_link_frame f;
+            if (copy_from_user(&f, (void __user *)arg, sizeof(f)))
+                return -EFAULT;
+            return gpio_link_tx(entry, &f);
+        }
+    case GPIO_IOCTL_RX_FRAME:
+        {
+            struct gpio_link_frame f;
+            if (!kfifo_out_spinlocked(&entry->rx_frames, &f, 1, &entry->rx_frames_lock))
+                return -EAGAIN;
+            if (copy_to_user((void __user *)arg, &f, sizeof(f)))
+                return -EFAULT;
+            return 0;
+        }
     case GPIO_IOCTL_GET_COUNT:
         {
             int val = atomic_read(&people_count);
@@ -163,23 +882,134 @@ static long gpio_fops_ioctl(struct file *filp, unsigned int cmd, unsigned long a
     }
 }
 
-static ssize_t gpio_fops_read(struct file *filp, char __user *buf, size_t len, loff_t *off) {
-    char out[16];
-    int count = atomic_read(&people_count);
-    int written = snprintf(out, sizeof(out), "%d\n", count);
+// Offset 0 yields the stream header, then as many whole records as fit.
+// Blocks until at least one record is available unless the file is
+// O_NONBLOCK or the caller (io_uring) asked for IOCB_NOWAIT, in which case
+// -EAGAIN is returned and readiness comes from .poll.
+static ssize_t gpio_fops_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct gpio_reader *reader = iocb->ki_filp->private_data;
+    struct gpio_entry *entry = reader->entry;
+    bool nowait = (iocb->ki_flags & IOCB_NOWAIT) || (iocb->ki_filp->f_flags & O_NONBLOCK);
+    struct gpio_event chunk[GPIO_READ_CHUNK];
+    size_t len = iov_iter_count(to);
+    size_t done = 0, bytes;
+    ssize_t ret;
+    int n;
 
-    if (*off > 0 || len < written)
-        return 0;
+    if (iocb->ki_pos == 0) {
+        if (len < sizeof(struct gpio_event_header))
+            return -EINVAL;
+    } else if (len < sizeof(struct gpio_event)) {
+        return -EINVAL;
+    }
 
-    if (copy_to_user(buf, out, written))
-        return -EFAULT;
+    // The cursors belong to the open file; serialise reads sharing it.
+    if (nowait) {
+        if (!mutex_trylock(&reader->lock))
+            return -EAGAIN;
+    } else if (mutex_lock_interruptible(&reader->lock)) {
+        return -ERESTARTSYS;
+    }
 
-    *off += written;
-    return written;
+    if (iocb->ki_pos == 0) {
+        struct gpio_event_header hdr = {
+            .magic = GPIO_EVENT_MAGIC,
+            .version = GPIO_EVENT_VERSION,
+            .record_size = sizeof(struct gpio_event),
+        };
+        if (copy_to_iter(&hdr, sizeof(hdr), to) != sizeof(hdr)) {
+            ret = -EFAULT;
+            goto out_unlock;
+        }
+        done = sizeof(hdr);
+    }
+
+    while (!done && !gpio_event_pending(reader)) {
+        if (READ_ONCE(entry->gone)) {
+            ret = 0;
+            goto out_unlock;
+        }
+        if (nowait) {
+            ret = -EAGAIN;
+            goto out_unlock;
+        }
+        mutex_unlock(&reader->lock);
+        ret = wait_event_interruptible(entry->ring_wait,
+                                       gpio_event_pending(reader) || READ_ONCE(entry->gone));
+        if (ret)
+            return ret;
+        if (mutex_lock_interruptible(&reader->lock))
+            return -ERESTARTSYS;
+    }
+
+    while (len - done >= sizeof(struct gpio_event)) {
+        int max = min_t(size_t, GPIO_READ_CHUNK, (len - done) / sizeof(struct gpio_event));
+        n = gpio_event_fetch(reader, chunk, max);
+        if (!n)
+            break;
+        bytes = n * sizeof(struct gpio_event);
+        if (copy_to_iter(chunk, bytes, to) != bytes) {
+            if (!done) {
+                ret = -EFAULT;
+                goto out_unlock;
+            }
+            break;
+        }
+        done += bytes;
+    }
+
+    iocb->ki_pos += done;
+    ret = done;
+out_unlock:
+    mutex_unlock(&reader->lock);
+    return ret;
+}
+
+static __poll_t gpio_fops_poll(struct file *filp, poll_table *wait) {
+    struct gpio_reader *reader = filp->private_data;
+    __poll_t mask = 0;
+
+    poll_wait(filp, &reader->entry->ring_wait, wait);
+    if (gpio_event_pending(reader))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (READ_ONCE(reader->entry->gone))
+        mask |= EPOLLIN | EPOLLRDNORM | EPOLLHUP;
+    return mask;
+}
+
+// Maps the logic-analyzer buffer read-only: ctrl page, then edge slots.
+static int gpio_fops_mmap(struct file *filp, struct vm_area_struct *vma) {
+    struct gpio_reader *reader = filp->private_data;
+    struct gpio_entry *entry = reader->entry;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+
+    if (vma->vm_pgoff != 0)
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+    mutex_lock(&entry->la_lock);
+    if (!entry->la_buf) {
+        ret = -ENODEV;
+    } else if (size > entry->la_size) {
+        ret = -EINVAL;
+    } else {
+        ret = remap_vmalloc_range(vma, entry->la_buf, 0);
+        if (!ret) {
+            vm_flags_clear(vma, VM_MAYWRITE);
+            vma->vm_ops = &gpio_la_vm_ops;
+            vma->vm_private_data = entry;
+            gpio_la_vm_open(vma);
+        }
+    }
+    mutex_unlock(&entry->la_lock);
+    return ret;
 }
 
 static ssize_t gpio_fops_write(struct file *filp, const char __user *buf, size_t len, loff_t *off) {
-    struct gpio_entry *entry = filp->private_data;
+    struct gpio_reader *reader = filp->private_data;
+    struct gpio_entry *entry = reader->entry;
     char kbuf[8] = {0};
     if (len >= sizeof(kbuf)) return -EINVAL;
     if (copy_from_user(kbuf, buf, len)) return -EFAULT;
@@ -203,8 +1033,10 @@ static ssize_t gpio_fops_write(struct file *filp, const char __user *buf, size_t
 static const struct file_operations gpio_fops = {
     .owner = THIS_MODULE,
     .open = gpio_fops_open,
-    .read = gpio_fops_read,
+    .read_iter = gpio_fops_read_iter,
     .write = gpio_fops_write,
+    .poll = gpio_fops_poll,
+    .mmap = gpio_fops_mmap,
     .release = gpio_fops_release,
     .fasync = gpio_fops_fasync,
     .unlocked_ioctl = gpio_fops_ioctl,
@@ -212,48 +1044,97 @@ static const struct file_operations gpio_fops = {
 
 // ---- SYSFS EXPORT / UNEXPORT ----
 
+// Returns a line with the table's reference held and no descriptor or
+// device attached yet.
+static struct gpio_entry *gpio_entry_alloc(int bcm) {
+    struct gpio_entry *entry;
+    int cpu;
+
+    entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+    if (!entry)
+        return NULL;
+
+    kref_init(&entry->ref);
+    entry->rings = alloc_percpu(struct gpio_cpu_ring);
+    if (!entry->rings) {
+        kfree(entry);
+        return NULL;
+    }
+    for_each_possible_cpu(cpu)
+        spin_lock_init(&per_cpu_ptr(entry->rings, cpu)->lock);
+    mutex_init(&entry->irq_lock);
+    entry->irq_cpu = -1;
+    pulse_classifier_init(&entry->classifier, ktime_get_ns());
+    entry->classifier.calib.max_shift_us = calib_max_shift_us;
+    entry->bcm_num = bcm;
+    init_waitqueue_head(&entry->ring_wait);
+    mutex_init(&entry->la_lock);
+    entry->encoding = GPIO_ENC_PULSE;
+    entry->bitrate = MANCH_DEFAULT_BITRATE;
+    manch_decoder_init(&entry->manch, entry->bitrate);
+    INIT_KFIFO(entry->rx_frames);
+    spin_lock_init(&entry->rx_frames_lock);
+    mutex_init(&entry->tx_lock);
+    init_completion(&entry->tx_done);
+    gpio_hrtimer_setup(&entry->tx_timer, gpio_tx_timer_fn, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_HARD);
+    return entry;
+}
+
 static ssize_t export_store(const struct class *class, const struct class_attribute *attr, const char *buf, size_t count) {
-    int bcm, minor;
+    int bcm, minor, ret;
     struct gpio_entry *entry;
     struct device *dev;
 
     if (kstrtoint(buf, 10, &bcm))
         return -EINVAL;
 
+    mutex_lock(&gpio_table_lock);
+    for (minor = 0; minor < MAX_GPIO; minor++) {
+        if (gpio_table[minor] && gpio_table[minor]->bcm_num == bcm) {
+            ret = -EBUSY;
+            goto out_unlock;
+        }
+    }
     for (minor = 0; minor < MAX_GPIO; minor++) {
         if (!gpio_table[minor])
             break;
     }
-    if (minor == MAX_GPIO)
-        return -ENOMEM;
-
-    entry = kzalloc(sizeof(*entry), GFP_KERNEL);
-    if (!entry)
-        return -ENOMEM;
+    if (minor == MAX_GPIO) {
+        ret = -ENOMEM;
+        goto out_unlock;
+    }
 
-    entry->bcm_num = bcm;
+    entry = gpio_entry_alloc(bcm);
+    if (!entry) {
+        ret = -ENOMEM;
+        goto out_unlock;
+    }
     entry->desc = gpio_to_desc(GPIOCHIP_BASE + bcm);
     if (!entry->desc) {
-        kfree(entry);
-        return -ENODEV;
+        gpio_entry_put(entry);
+        ret = -ENODEV;
+        goto out_unlock;
     }
 
     gpiod_direction_input(entry->desc);
-    dev = device_create(gpiod_class, NULL, MKDEV(major_num, minor), NULL, "gpio%d", bcm);
+    gpio_table[minor] = entry;
+    dev = device_create_with_groups(gpiod_class, NULL, MKDEV(major_num, minor), entry,
+                                    gpio_groups, "gpio%d", bcm);
     if (IS_ERR(dev)) {
-        kfree(entry);
-        return PTR_ERR(dev);
+        gpio_table[minor] = NULL;
+        gpio_entry_put(entry);
+        ret = PTR_ERR(dev);
+        goto out_unlock;
     }
-
     entry->dev = dev;
-    dev_set_drvdata(dev, entry);
-    device_create_file(dev, &dev_attr_value);
-    device_create_file(dev, &dev_attr_direction);
-
-    gpio_table[minor] = entry;
+    mutex_unlock(&gpio_table_lock);
 
     pr_info("[sysprog_gpio] Exported GPIO %d at minor %d\n", bcm, minor);
     return count;
+
+out_unlock:
+    mutex_unlock(&gpio_table_lock);
+    return ret;
 }
 
 static ssize_t unexport_store(const struct class *class, const struct class_attribute *attr, const char *buf, size_t count) {
@@ -262,20 +1143,19 @@ static ssize_t unexport_store(const struct class *class, const struct class_attr
     if (kstrtoint(buf, 10, &bcm))
         return -EINVAL;
 
+    mutex_lock(&gpio_table_lock);
     for (idx = 0; idx < MAX_GPIO; idx++) {
         if (gpio_table[idx] && gpio_table[idx]->bcm_num == bcm)
             break;
     }
 
-    if (idx == MAX_GPIO)
+    if (idx == MAX_GPIO) {
+        mutex_unlock(&gpio_table_lock);
         return -ENOENT;
+    }
 
-    struct gpio_entry *entry = gpio_table[idx];
-    device_remove_file(entry->dev, &dev_attr_value);
-    device_remove_file(entry->dev, &dev_attr_direction);
-    device_destroy(gpiod_class, MKDEV(major_num, idx));
-    kfree(entry);
-    gpio_table[idx] = NULL;
+    gpio_entry_remove(idx);
+    mutex_unlock(&gpio_table_lock);
 
     pr_info("[sysprog_gpio] Unexported GPIO %d\n", bcm);
     return count;
@@ -340,13 +1220,8 @@ static int __init gpio_driver_init(void) {
 
 static void __exit gpio_driver_exit(void) {
     for (int i = 0; i < MAX_GPIO; i++) {
-        if (gpio_table[i]) {
-            device_remove_file(gpio_table[i]->dev, &dev_attr_value);
-            device_remove_file(gpio_table[i]->dev, &dev_attr_direction);
-            device_destroy(gpiod_class, MKDEV(major_num, i));
-            kfree(gpio_table[i]);
-            gpio_table[i] = NULL;
-        }
+        if (gpio_table[i])
+            gpio_entry_remove(i);
     }
 
     cdev_del(&gpio_cdev);
@@ -361,3 +1236,7 @@ module_exit(gpio_driver_exit);
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Jiwon Shin");
 MODULE_DESCRIPTION("GPIO driver for people counter with sysfs and IRQ support");
+
+#if IS_ENABLED(CONFIG_KUNIT) && defined(SYSPROG_GPIO_KUNIT)
+#include "count_kunit.c"
+#endif
@@ -0,0 +1,413 @@
+// count_kunit.c - KUnit suites for count.ko, built into the module by
+// `make kunit` (SYSPROG_GPIO_KUNIT=y) and run when it loads. Included from
+// the end of count.c so the static helpers are reachable; lines are made
+// with gpio_entry_alloc() and have no descriptor, so nothing here touches
+// GPIO hardware and the suites run under UML.
+#include <kunit/test.h>
+#include <linux/kthread.h>
+
+// ---- PULSE CLASSIFIER ----
+
+// Rising edge, then a falling edge width_ms later.
+static int pulse_test_pulse(struct pulse_classifier *pc, u64 *t, u32 width_ms, u32 *width_us) {
+    *t += 20 * NSEC_PER_MSEC;
+    pulse_classify_edge(pc, *t, 1, width_us);
+    *t += (u64)width_ms * NSEC_PER_MSEC;
+    return pulse_classify_edge(pc, *t, 0, width_us);
+}
+
+static void pulse_classify_windows_test(struct kunit *test) {
+    struct pulse_classifier pc;
+    u64 t = NSEC_PER_SEC;
+    u32 width;
+
+    pulse_classifier_init(&pc, t);
+    KUNIT_EXPECT_EQ(test, pulse_classify_edge(&pc, t + NSEC_PER_MSEC, 1, &width), GPIO_SYM_NONE);
+    t += NSEC_PER_MSEC;
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 100, &width), GPIO_SYM_ENTRY);
+    KUNIT_EXPECT_EQ(test, width, 100000u);
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 200, &width), GPIO_SYM_EXIT);
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 150, &width), PULSE_REJECTED);
+    // Windows are exclusive on both ends.
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 80, &width), PULSE_REJECTED);
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 220, &width), PULSE_REJECTED);
+    KUNIT_EXPECT_EQ(test, pc.accepted, 2u);
+    KUNIT_EXPECT_EQ(test, pc.rejected, 3u);
+    KUNIT_EXPECT_EQ(test, pulse_reject_ppm(&pc), 600000u);
+}
+
+// Pulses 20 ms longer than nominal pull both windows over them.
+static void pulse_calib_drift_test(struct kunit *test) {
+    struct pulse_classifier pc;
+    u64 t = NSEC_PER_SEC;
+    u32 width;
+    int i;
+
+    pulse_classifier_init(&pc, t);
+    pc.calib.enabled = 1;
+    for (i = 0; i < 64 * PULSE_CALIB_PERIOD; i++)
+        pulse_test_pulse(&pc, &t, i & 1 ? 220 : 120, &width);
+
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 120, &width), GPIO_SYM_ENTRY);
+    KUNIT_EXPECT_EQ(test, pulse_test_pulse(&pc, &t, 220, &width), GPIO_SYM_EXIT);
+    KUNIT_EXPECT_LE(test, (pc.entry.lo_us + pc.entry.hi_us) / 2,
+                    (PULSE_ENTRY_LO_US + PULSE_ENTRY_HI_US) / 2 + PULSE_CALIB_MAX_SHIFT_US);
+    KUNIT_EXPECT_LE(test, (pc.exit.lo_us + pc.exit.hi_us) / 2,
+                    (PULSE_EXIT_LO_US + PULSE_EXIT_HI_US) / 2 + PULSE_CALIB_MAX_SHIFT_US);
+    KUNIT_EXPECT_LT(test, pc.entry.hi_us, pc.exit.lo_us);
+}
+
+// Ever shorter pulses drag the entry window down to zero but not past
+// it, even with a max_shift_us too large to honour; reset forgets them.
+static void pulse_calib_bounds_test(struct kunit *test) {
+    struct pulse_classifier pc;
+    u64 t = NSEC_PER_SEC;
+    u32 width, ms, i;
+
+    pulse_classifier_init(&pc, t);
+    pc.calib.enabled = 1;
+    pc.calib.max_shift_us = 200000;
+    for (ms = 90; ms >= 5; ms -= 5) {
+        for (i = 0; i < 8 * PULSE_CALIB_PERIOD; i++)
+            pulse_test_pulse(&pc, &t, ms, &width);
+    }
+    KUNIT_EXPECT_EQ(test, pc.entry.lo_us, 0u);
+    KUNIT_EXPECT_EQ(test, pc.entry.hi_us, PULSE_ENTRY_HI_US - PULSE_ENTRY_LO_US);
+    KUNIT_EXPECT_EQ(test, pc.exit.lo_us, (u32)PULSE_EXIT_LO_US);
+
+    pulse_calib_reset(&pc);
+    KUNIT_EXPECT_EQ(test, pc.entry.lo_us, (u32)PULSE_ENTRY_LO_US);
+    KUNIT_EXPECT_EQ(test, pc.calib.pending, 0u);
+    KUNIT_EXPECT_EQ(test, pc.calib.hist[5000 / PULSE_HIST_BUCKET_US], 0);
+}
+
+static struct kunit_case pulse_classify_cases[] = {
+    KUNIT_CASE(pulse_classify_windows_test),
+    KUNIT_CASE(pulse_calib_drift_test),
+    KUNIT_CASE(pulse_calib_bounds_test),
+    {}
+};
+
+static struct kunit_suite pulse_classify_suite = {
+    .name = "sysprog_gpio_classify",
+    .test_cases = pulse_classify_cases,
+};
+
+// ---- EVENT RING ----
+
+static void gpio_ring_order_test(struct kunit *test) {
+    struct gpio_ring *ring = kunit_kzalloc(test, sizeof(*ring), GFP_KERNEL);
+    struct gpio_event ev = {}, out[GPIO_READ_CHUNK];
+    u32 cursor, i;
+    int n, got = 0;
+
+    KUNIT_ASSERT_NOT_NULL(test, ring);
+    // Start just below the u32 wrap so positions roll over mid-test.
+    ring->head = cursor = 0xfffffff0u;
+    for (i = 0; i < 40; i++) {
+        ev.seq = i;
+        gpio_ring_push(ring, &ev);
+    }
+    while ((n = gpio_ring_fetch(ring, &cursor, out, GPIO_READ_CHUNK)) > 0) {
+        for (i = 0; i < n; i++)
+            KUNIT_EXPECT_EQ(test, out[i].seq, (u32)(got + i));
+        got += n;
+    }
+    KUNIT_EXPECT_EQ(test, got, 40);
+    KUNIT_EXPECT_FALSE(test, gpio_ring_pending(ring, cursor));
+}
+
+static void gpio_ring_overrun_test(struct kunit *test) {
+    struct gpio_ring *ring = kunit_kzalloc(test, sizeof(*ring), GFP_KERNEL);
+    struct gpio_event ev = {}, out[4];
+    u32 cursor = 0, i;
+
+    KUNIT_ASSERT_NOT_NULL(test, ring);
+    for (i = 0; i < GPIO_RING_SIZE + 10; i++) {
+        ev.seq = i;
+        gpio_ring_push(ring, &ev);
+    }
+    KUNIT_EXPECT_EQ(test, gpio_ring_fetch(ring, &cursor, out, 4), 4);
+    KUNIT_EXPECT_EQ(test, out[0].seq, 10u);
+    KUNIT_EXPECT_EQ(test, out[3].seq, 13u);
+    KUNIT_EXPECT_EQ(test, cursor, 14u);
+}
+
+static struct kunit_case gpio_ring_cases[] = {
+    KUNIT_CASE(gpio_ring_order_test),
+    KUNIT_CASE(gpio_ring_overrun_test),
+    {}
+};
+
+static struct kunit_suite gpio_ring_suite = {
+    .name = "sysprog_gpio_ring",
+    .test_cases = gpio_ring_cases,
+};
+
+// ---- ENTRY LIFETIME AND READERS ----
+
+// A struct file and inode are all gpio_fops_open() looks at.
+struct gpio_test_file {
+    struct inode inode;
+    struct file file;
+};
+
+// Puts a fresh line in the first free slot, as export_store() does.
+static int gpio_test_export(int bcm) {
+    struct gpio_entry *entry = gpio_entry_alloc(bcm);
+    int minor;
+
+    if (!entry)
+        return -ENOMEM;
+    mutex_lock(&gpio_table_lock);
+    for (minor = 0; minor < MAX_GPIO && gpio_table[minor]; minor++)
+        ;
+    if (minor < MAX_GPIO)
+        gpio_table[minor] = entry;
+    mutex_unlock(&gpio_table_lock);
+    if (minor == MAX_GPIO) {
+        gpio_entry_put(entry);
+        return -ENOMEM;
+    }
+    return minor;
+}
+
+static void gpio_test_unexport(int minor) {
+    mutex_lock(&gpio_table_lock);
+    if (gpio_table[minor])
+        gpio_entry_remove(minor);
+    mutex_unlock(&gpio_table_lock);
+}
+
+static int gpio_test_open(struct gpio_test_file *tf, int minor) {
+    memset(tf, 0, sizeof(*tf));
+    tf->inode.i_rdev = MKDEV(major_num, minor);
+    spin_lock_init(&tf->file.f_lock);
+    tf->file.f_flags = O_NONBLOCK;
+    return gpio_fops_open(&tf->inode, &tf->file);
+}
+
+static void gpio_test_close(struct gpio_test_file *tf) {
+    gpio_fops_release(&tf->inode, &tf->file);
+}
+
+static ssize_t gpio_test_read(struct gpio_test_file *tf, void *buf, size_t len, loff_t *pos) {
+    struct kvec kv = { .iov_base = buf, .iov_len = len };
+    struct iov_iter iter;
+    struct kiocb kiocb;
+    ssize_t ret;
+
+    init_sync_kiocb(&kiocb, &tf->file);
+    kiocb.ki_pos = *pos;
+    iov_iter_kvec(&iter, ITER_DEST, &kv, 1, len);
+    ret = gpio_fops_read_iter(&kiocb, &iter);
+    *pos = kiocb.ki_pos;
+    return ret;
+}
+
+// Stores a record on a given CPU's ring, as the IRQ on that CPU would.
+static void gpio_test_push(struct gpio_entry *entry, int cpu, u64 ktime_ns) {
+    struct gpio_cpu_ring *cr = per_cpu_ptr(entry->rings, cpu);
+    struct gpio_event ev = { .ktime_ns = ktime_ns, .line = cpu };
+    unsigned long flags;
+
+    spin_lock_irqsave(&cr->lock, flags);
+    ev.seq = atomic_inc_return(&entry->seq) - 1;
+    gpio_ring_push(&cr->ring, &ev);
+    spin_unlock_irqrestore(&cr->lock, flags);
+}
+
+static void gpio_test_exit(struct kunit *test) {
+    for (int minor = 0; minor < MAX_GPIO; minor++)
+        gpio_test_unexport(minor);
+}
+
+// Records interleaved across the per-CPU rings come back in timestamp
+// order, and a short fetch leaves the rest for the next one.
+static void gpio_merge_test(struct kunit *test) {
+    struct gpio_test_file *tf = kunit_kzalloc(test, sizeof(*tf), GFP_KERNEL);
+    struct gpio_event out[3];
+    struct gpio_reader *reader;
+    int minor, cpu, i, n, ncpus = 0, got = 0;
+    u64 last = 0;
+
+    KUNIT_ASSERT_NOT_NULL(test, tf);
+    minor = gpio_test_export(17);
+    KUNIT_ASSERT_GE(test, minor, 0);
+    KUNIT_ASSERT_EQ(test, gpio_test_open(tf, minor), 0);
+    reader = tf->file.private_data;
+
+    for_each_possible_cpu(cpu)
+        ncpus++;
+    for (i = 0; i < 20; i++) {
+        for_each_possible_cpu(cpu)
+            gpio_test_push(reader->entry, cpu, 1000 + (u64)i * ncpus * 10 + (ncpus - 1 - cpu) * 10);
+    }
+    while ((n = gpio_event_fetch(reader, out, ARRAY_SIZE(out))) > 0) {
+        for (i = 0; i < n; i++) {
+            KUNIT_EXPECT_GE(test, out[i].ktime_ns, last);
+            last = out[i].ktime_ns;
+        }
+        got += n;
+    }
+    KUNIT_EXPECT_EQ(test, got, 20 * ncpus);
+    KUNIT_EXPECT_FALSE(test, gpio_event_pending(reader));
+    gpio_test_close(tf);
+}
+
+// A file opened before unexport keeps the line alive, reads the header
+// and then EOF, and polls as hung up; new opens fail.
+static void gpio_unexport_open_test(struct kunit *test) {
+    struct gpio_test_file *tf = kunit_kzalloc(test, sizeof(*tf), GFP_KERNEL);
+    struct gpio_test_file *late = kunit_kzalloc(test, sizeof(*late), GFP_KERNEL);
+    struct gpio_event_header hdr;
+    struct gpio_entry *entry;
+    loff_t pos = 0;
+    int minor;
+
+    KUNIT_ASSERT_NOT_NULL(test, tf);
+    KUNIT_ASSERT_NOT_NULL(test, late);
+    minor = gpio_test_export(17);
+    KUNIT_ASSERT_GE(test, minor, 0);
+    KUNIT_ASSERT_EQ(test, gpio_test_open(tf, minor), 0);
+    entry = ((struct gpio_reader *)tf->file.private_data)->entry;
+    KUNIT_EXPECT_EQ(test, kref_read(&entry->ref), 2u);
+    KUNIT_EXPECT_FALSE(test, gpio_fops_poll(&tf->file, NULL) & EPOLLHUP);
+
+    gpio_test_unexport(minor);
+    KUNIT_EXPECT_EQ(test, kref_read(&entry->ref), 1u);
+    KUNIT_EXPECT_EQ(test, gpio_test_open(late, minor), -ENODEV);
+    KUNIT_EXPECT_TRUE(test, gpio_fops_poll(&tf->file, NULL) & EPOLLHUP);
+    KUNIT_EXPECT_EQ(test, gpio_test_read(tf, &hdr, sizeof(hdr), &pos), (ssize_t)sizeof(hdr));
+    KUNIT_EXPECT_EQ(test, hdr.magic, GPIO_EVENT_MAGIC);
+    KUNIT_EXPECT_EQ(test, gpio_test_read(tf, &hdr, sizeof(struct gpio_event), &pos), 0);
+    gpio_test_close(tf);
+}
+
+struct gpio_race {
+    struct gpio_test_file tf;
+    atomic_t *opened;
+    atomic_t *refused;
+    atomic_t *bad;
+};
+
+static int gpio_race_opener(void *arg) {
+    struct gpio_race *r = arg;
+    struct gpio_event ev[2];
+    loff_t pos;
+    ssize_t n;
+    int ret;
+
+    while (!kthread_should_stop()) {
+        ret = gpio_test_open(&r->tf, 0);
+        if (ret == -ENODEV) {
+            atomic_inc(r->refused);
+        } else if (ret) {
+            atomic_inc(r->bad);
+        } else {
+            atomic_inc(r->opened);
+            pos = 0;
+            n = gpio_test_read(&r->tf, ev, sizeof(ev), &pos);
+            if (n < (ssize_t)sizeof(struct gpio_event_header))
+                atomic_inc(r->bad);
+            n = gpio_test_read(&r->tf, ev, sizeof(ev), &pos);
+            if (n < 0 && n != -EAGAIN)
+                atomic_inc(r->bad);
+            gpio_fops_poll(&r->tf.file, NULL);
+            gpio_test_close(&r->tf);
+        }
+        cond_resched();
+    }
+    return 0;
+}
+
+// Openers hammer minor 0 while it is exported and unexported underneath
+// them. Every open must either get a working file or -ENODEV; use after
+// free or a leaked reference shows up under KASAN and kmemleak.
+static void gpio_export_open_race_test(struct kunit *test) {
+    struct gpio_race *r = kunit_kcalloc(test, 2, sizeof(*r), GFP_KERNEL);
+    struct task_struct *task[2];
+    atomic_t opened = ATOMIC_INIT(0), refused = ATOMIC_INIT(0), bad = ATOMIC_INIT(0);
+    int i, k, started = 0;
+
+    KUNIT_ASSERT_NOT_NULL(test, r);
+    for (k = 0; k < 2; k++) {
+        r[k] = (struct gpio_race){ .opened = &opened, .refused = &refused, .bad = &bad };
+        task[k] = kthread_run(gpio_race_opener, &r[k], "gpio_race/%d", k);
+        if (IS_ERR(task[k])) {
+            KUNIT_FAIL(test, "kthread_run: %ld", PTR_ERR(task[k]));
+            break;
+        }
+        started++;
+    }
+    // The openers use r, so no assertion may leave before they stop.
+    for (i = 0; started == 2 && i < 2000; i++) {
+        if (gpio_test_export(17) != 0) {
+            KUNIT_FAIL(test, "export %d did not get minor 0", i);
+            break;
+        }
+        if (i & 1)
+            gpio_test_push(gpio_table[0], raw_smp_processor_id(), i);
+        cond_resched();
+        gpio_test_unexport(0);
+    }
+    for (k = 0; k < started; k++)
+        kthread_stop(task[k]);
+
+    kunit_info(test, "%d opens, %d refused\n", atomic_read(&opened), atomic_read(&refused));
+    KUNIT_EXPECT_EQ(test, atomic_read(&bad), 0);
+    KUNIT_EXPECT_GT(test, atomic_read(&opened) + atomic_read(&refused), 0);
+    KUNIT_EXPECT_NULL(test, gpio_table[0]);
+}
+
+// Timed hot paths, reported rather than asserted: UML timing says little
+// about the target.
+static void gpio_hotpath_bench_test(struct kunit *test) {
+    struct gpio_test_file *tf = kunit_kzalloc(test, sizeof(*tf), GFP_KERNEL);
+    struct pulse_classifier pc;
+    struct gpio_event out[GPIO_READ_CHUNK];
+    struct gpio_reader *reader;
+    u64 t = NSEC_PER_SEC, start, elapsed;
+    u32 width;
+    int minor, i, n = 0;
+
+    KUNIT_ASSERT_NOT_NULL(test, tf);
+    pulse_classifier_init(&pc, t);
+    start = ktime_get_ns();
+    for (i = 0; i < 100000; i++)
+        pulse_test_pulse(&pc, &t, i & 1 ? 200 : 100, &width);
+    elapsed = ktime_get_ns() - start;
+    KUNIT_EXPECT_EQ(test, pc.accepted, 100000u);
+    kunit_info(test, "classifier: %llu ns/edge\n", div_u64(elapsed, 200000));
+
+    minor = gpio_test_export(17);
+    KUNIT_ASSERT_GE(test, minor, 0);
+    KUNIT_ASSERT_EQ(test, gpio_test_open(tf, minor), 0);
+    reader = tf->file.private_data;
+    start = ktime_get_ns();
+    for (i = 0; i < 100000; i++) {
+        gpio_event_push(reader->entry, ns_to_ktime(i), 0, GPIO_SYM_ENTRY, 0, 0);
+        if ((i & (GPIO_READ_CHUNK - 1)) == GPIO_READ_CHUNK - 1)
+            n += gpio_event_fetch(reader, out, GPIO_READ_CHUNK);
+    }
+    elapsed = ktime_get_ns() - start;
+    KUNIT_EXPECT_EQ(test, n, 100000);
+    kunit_info(test, "ring push+fetch/%d: %llu ns/record\n", GPIO_READ_CHUNK, div_u64(elapsed, 100000));
+    gpio_test_close(tf);
+}
+
+static struct kunit_case gpio_entry_cases[] = {
+    KUNIT_CASE(gpio_merge_test),
+    KUNIT_CASE(gpio_unexport_open_test),
+    KUNIT_CASE_SLOW(gpio_export_open_race_test),
+    KUNIT_CASE_SLOW(gpio_hotpath_bench_test),
+    {}
+};
+
+static struct kunit_suite gpio_entry_suite = {
+    .name = "sysprog_gpio_entry",
+    .exit = gpio_test_exit,
+    .test_cases = gpio_entry_cases,
+};
+
+kunit_test_suites(&pulse_classify_suite, &gpio_ring_suite, &gpio_entry_suite);
@@ -0,0 +1,47 @@
+// gpio_ring.h - broadcast event ring shared by count.ko and the benchmarks.
+// One producer appends; every reader owns a cursor (the ring position of
+// the next record it wants). Callers provide the locking around push and
+// fetch, and fill in the record seq themselves.
+#ifndef GPIO_RING_H
+#define GPIO_RING_H
+
+#include <linux/types.h>
+#include "sysprog_gpio.h"
+
+#define GPIO_RING_SIZE 1024     /* power of two */
+
+struct gpio_ring {
+    __u32 head;                 /* position of the next record */
+    struct gpio_event rec[GPIO_RING_SIZE];
+};
+
+static inline __u32 gpio_ring_head(const struct gpio_ring *ring) {
+    return *(const volatile __u32 *)&ring->head;
+}
+
+static inline int gpio_ring_pending(const struct gpio_ring *ring, __u32 cursor) {
+    return gpio_ring_head(ring) != cursor;
+}
+
+// Stores ev and returns its ring position.
+static inline __u32 gpio_ring_push(struct gpio_ring *ring, const struct gpio_event *ev) {
+    ring->rec[ring->head & (GPIO_RING_SIZE - 1)] = *ev;
+    return ring->head++;
+}
+
+// Copies up to max records at *cursor into out. A reader that fell more
+// than a ring behind skips ahead; the record seq gap shows the loss.
+static inline int gpio_ring_fetch(const struct gpio_ring *ring, __u32 *cursor,
+                                  struct gpio_event *out, int max) {
+    int n = 0;
+
+    if (ring->head - *cursor > GPIO_RING_SIZE)
+        *cursor = ring->head - GPIO_RING_SIZE;
+    while (n < max && *cursor != ring->head) {
+        out[n++] = ring->rec[*cursor & (GPIO_RING_SIZE - 1)];
+        (*cursor)++;
+    }
+    return n;
+}
+
+#endif /* GPIO_RING_H */
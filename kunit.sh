@@ -0,0 +1,60 @@
+#!/bin/sh
+# kunit.sh - count.ko 의 KUnit 스위트(count_kunit.c) 실행기
+#
+#   ./kunit.sh UML_KDIR   ARCH=um 으로 빌드한 커널 트리로 UML 을 띄워 실행
+#   ./kunit.sh            지금 돌고 있는 커널에 insmod 해서 실행 (root 필요)
+#
+# UML 커널 설정: CONFIG_KUNIT=y CONFIG_MODULES=y CONFIG_HOSTFS=y CONFIG_GPIOLIB=y
+# export/open 경합 테스트는 CONFIG_KASAN=y, CONFIG_DEBUG_KMEMLEAK=y 와
+# 함께 돌려야 use-after-free 와 참조 누수가 드러난다.
+# UML 은 호스트 / 를 hostfs 루트로 부팅하고, 결과는 kunit.log 에 남는다.
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LOG=$HERE/kunit.log
+
+rm -f "$LOG"
+if [ -n "$1" ]; then
+    KDIR=$(cd "$1" && pwd)
+    make -C "$KDIR" ARCH=um M="$HERE" SYSPROG_GPIO_KUNIT=y modules
+
+    INIT=$(mktemp /tmp/sysprog-kunit.XXXXXX)
+    cat > "$INIT" <<INIT_EOF
+#!/bin/sh
+mount -t proc proc /proc
+mount -t sysfs sysfs /sys
+insmod $HERE/count.ko && rmmod count
+dmesg > $LOG
+poweroff -f
+INIT_EOF
+    chmod +x "$INIT"
+    "$KDIR/linux" mem=256M rootfstype=hostfs rootflags=/ rw init="$INIT" \
+        con=null con0=null,fd:2 < /dev/null || true
+    rm -f "$INIT"
+else
+    make -C "/lib/modules/$(uname -r)/build" M="$HERE" SYSPROG_GPIO_KUNIT=y modules
+    sudo rmmod count 2>/dev/null || true
+    sudo dmesg -C
+    sudo insmod "$HERE/count.ko"
+    sudo rmmod count
+    sudo dmesg > "$LOG"
+fi
+
+if [ ! -s "$LOG" ]; then
+    echo "kunit: no kernel log captured" >&2
+    exit 1
+fi
+
+# KTAP 줄만 추려 보여주고, 스위트가 하나라도 빠지거나 실패하면 실패
+sed -n 's/^\[[^]]*\] *//; /^ *\(ok\|not ok\|# \)/p' "$LOG"
+if grep -q 'not ok' "$LOG"; then
+    echo "kunit: FAILED (see $LOG)" >&2
+    exit 1
+fi
+for suite in sysprog_gpio_classify sysprog_gpio_ring sysprog_gpio_entry; do
+    if ! grep -q "ok [0-9]* $suite\$" "$LOG"; then
+        echo "kunit: suite $suite did not run (see $LOG)" >&2
+        exit 1
+    fi
+done
+echo "kunit: all suites passed"
@@ -0,0 +1,208 @@
+// la.c - count.ko 로직 애널라이저 캡처를 파일/VCD로 스트리밍
+//
+// 드라이버가 mmap으로 노출한 엣지 링을 직접 읽으므로 엣지마다
+// 시스템 콜이나 copy_to_user가 없다. 일반 카운팅은 그대로 동작한다.
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "sysprog_gpio.h"
+
+#define DEFAULT_GPIO_DEV  "/dev/gpio17"
+#define LA_DEFAULT_SLOTS  (1u << 20)   // 16 MB 링
+#define LA_POLL_NS        10000000L    // 링 확인 주기 (10 ms)
+#define LA_COPY_BATCH     4096
+#define LA_OUT_BUF        (1 << 20)
+
+enum la_format { LA_FMT_NONE, LA_FMT_RAW, LA_FMT_VCD };
+
+static volatile int running = 1;
+
+void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void vcd_header(FILE *out, unsigned line) {
+    fprintf(out, "$timescale 1ns $end\n");
+    fprintf(out, "$scope module sysprog_gpio $end\n");
+    fprintf(out, "$var wire 1 ! gpio%u $end\n", line);
+    fprintf(out, "$upscope $end\n");
+    fprintf(out, "$enddefinitions $end\n");
+}
+
+// 복사해 둔 엣지를 출력 형식에 맞춰 기록. VCD 시간은 첫 엣지 기준
+static void emit(FILE *out, enum la_format fmt, const struct gpio_la_edge *e, size_t n,
+                 uint64_t *origin) {
+    if (fmt == LA_FMT_RAW) {
+        fwrite(e, sizeof(*e), n, out);
+    } else if (fmt == LA_FMT_VCD) {
+        for (size_t i = 0; i < n; i++) {
+            if (*origin == 0)
+                *origin = e[i].ktime_ns;
+            fprintf(out, "#%llu\n%u!\n",
+                    (unsigned long long)(e[i].ktime_ns - *origin), e[i].level ? 1 : 0);
+        }
+    }
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s [device_path] [-slots N] [-o FILE | -vcd FILE] [-duration SEC]\n", prog);
+    printf("  -slots N      Edge ring size, power of two (default %u)\n", LA_DEFAULT_SLOTS);
+    printf("  -o FILE       Write raw edge records (struct gpio_la_edge)\n");
+    printf("  -vcd FILE     Write a VCD trace for waveform viewers\n");
+    printf("  -duration SEC Stop after SEC seconds (default: until Ctrl+C)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *dev_path = DEFAULT_GPIO_DEV, *out_path = NULL;
+    enum la_format fmt = LA_FMT_NONE;
+    uint32_t slots = LA_DEFAULT_SLOTS;
+    double duration = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-slots") == 0 && i + 1 < argc) {
+            slots = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+            fmt = LA_FMT_RAW;
+        } else if (strcmp(argv[i], "-vcd") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+            fmt = LA_FMT_VCD;
+        } else if (strcmp(argv[i], "-duration") == 0 && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            dev_path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int fd = open(dev_path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open GPIO device");
+        return 1;
+    }
+    // IRQ 는 파일마다 참조를 잡으므로 rx 와 어느 순서로 떠도 공유된다
+    if (ioctl(fd, GPIO_IOCTL_ENABLE_IRQ, 0) < 0) {
+        perror("ioctl - enable irq");
+        close(fd);
+        return 1;
+    }
+    if (ioctl(fd, GPIO_IOCTL_LA_START, &slots) < 0) {
+        perror("ioctl - la start");
+        close(fd);
+        return 1;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t map_len = (page + (size_t)slots * sizeof(struct gpio_la_edge) + page - 1) & ~(page - 1);
+    void *map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        ioctl(fd, GPIO_IOCTL_LA_STOP);
+        close(fd);
+        return 1;
+    }
+    const struct gpio_la_ctrl *ctrl = map;
+    const struct gpio_la_edge *ring = (const void *)((const char *)map + page);
+    if (ctrl->hdr.magic != GPIO_LA_MAGIC || ctrl->hdr.version != GPIO_LA_VERSION ||
+        ctrl->hdr.record_size != sizeof(struct gpio_la_edge) || ctrl->capacity != slots) {
+        fprintf(stderr, "[LA] Unexpected capture buffer layout\n");
+        munmap(map, map_len);
+        close(fd);
+        return 1;
+    }
+
+    FILE *out = NULL;
+    if (out_path) {
+        out = fopen(out_path, "wb");
+        if (out == NULL) {
+            perror(out_path);
+            munmap(map, map_len);
+            close(fd);
+            return 1;
+        }
+        setvbuf(out, NULL, _IOFBF, LA_OUT_BUF);
+        if (fmt == LA_FMT_RAW)
+            fwrite(&ctrl->hdr, sizeof(ctrl->hdr), 1, out);
+        else
+            vcd_header(out, ctrl->line);
+    }
+
+    printf("[LA] Capturing gpio%u into %u slots%s%s\n", ctrl->line, slots,
+           out_path ? " -> " : "", out_path ? out_path : "");
+
+    static struct gpio_la_edge batch[LA_COPY_BATCH];
+    const uint32_t mask = slots - 1;
+    uint32_t tail = 0;
+    uint64_t edges = 0, lost = 0, origin = 0;
+    uint64_t start = now_ns(), stop = duration > 0 ? start + (uint64_t)(duration * 1e9) : 0;
+    struct timespec nap = { 0, LA_POLL_NS };
+
+    while (running && (stop == 0 || now_ns() < stop)) {
+        uint32_t head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            nanosleep(&nap, NULL);
+            continue;
+        }
+        if (head - tail >= slots) {
+            lost += head - tail - slots + 1;
+            tail = head - slots + 1;
+        }
+        while (tail != head) {
+            uint32_t n = head - tail;
+            if (n > LA_COPY_BATCH)
+                n = LA_COPY_BATCH;
+            for (uint32_t i = 0; i < n; i++)
+                batch[i] = ring[(tail + i) & mask];
+
+            // 복사하는 동안 덮어쓰인 슬롯은 버린다
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            uint32_t now_head = __atomic_load_n(&ctrl->head, __ATOMIC_RELAXED);
+            uint32_t skip = now_head - tail >= slots ? now_head + 1 - tail - slots : 0;
+            if (skip > n)
+                skip = n;
+            lost += skip;
+            if (out)
+                emit(out, fmt, batch + skip, n - skip, &origin);
+            edges += n - skip;
+            tail += n;
+            if (skip == n)
+                break;      // 링 한 바퀴 이상 밀림: 최신 head부터 다시
+        }
+    }
+
+    double secs = (now_ns() - start) / 1e9;
+    ioctl(fd, GPIO_IOCTL_LA_STOP);
+    printf("[LA] %llu edges, %llu lost, %.1f s, %.0f edges/s\n",
+           (unsigned long long)edges, (unsigned long long)lost, secs,
+           secs > 0 ? edges / secs : 0.0);
+
+    if (out)
+        fclose(out);
+    munmap(map, map_len);
+    close(fd);
+    return 0;
+}
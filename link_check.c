@@ -0,0 +1,153 @@
+// link_check.c - 링크 계층 자체 검사 (하드웨어 없이 실행)
+//
+// count.ko 와 같은 헤더(link_frame.h, manchester.h)로 CRC 기준값, DELTA
+// 페이로드, 프레임 길이 계산을 확인하고, 무작위 프레임을 간격 없이 이어
+// 붙인 맨체스터 엣지열을 지터를 섞어 디코더에 넣어 전부 복원되는지 본다.
+// 하나라도 틀리면 0 이 아닌 값으로 끝난다.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "link_frame.h"
+#include "manchester.h"
+
+static int failures;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL: " __VA_ARGS__);              \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+// CRC-16/CCITT-FALSE 의 표준 검사값
+static void check_crc(void) {
+    const char *msg = "123456789";
+    uint16_t crc = link_crc16((const uint8_t *)msg, strlen(msg), 0xFFFF);
+
+    CHECK(crc == 0x29B1, "crc16(\"123456789\") = 0x%04X, want 0x29B1", crc);
+}
+
+static void check_delta(void) {
+    static const int16_t counts[] = { 0, 1, -1, 4096, -4096, 32767, -32768 };
+    static const uint16_t seqs[] = { 0, 1, 0x7FFF, 0x8000, 0xFFFF };
+    uint8_t p[LINK_DELTA_LEN];
+
+    for (size_t s = 0; s < sizeof(seqs) / sizeof(seqs[0]); s++) {
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+            int16_t entries = counts[i], exits = counts[sizeof(counts) / sizeof(counts[0]) - 1 - i];
+            uint16_t seq;
+            int16_t e, x;
+
+            link_delta_encode(p, seqs[s], entries, exits);
+            link_delta_decode(p, &seq, &e, &x);
+            CHECK(seq == seqs[s] && e == entries && x == exits,
+                  "delta %u %+d %+d came back as %u %+d %+d", seqs[s], entries, exits, seq, e, x);
+        }
+    }
+}
+
+// manch_frame_ns() 가 실제로 인코딩되는 반비트 수와 맞아야 송신 일정이 맞는다
+static void check_frame_time(uint32_t bitrate) {
+    static uint8_t halves[MANCH_MAX_HALVES];
+    uint8_t payload[LINK_MAX_PAYLOAD] = { 0 }, frame[LINK_MAX_FRAME];
+
+    for (unsigned int len = 0; len <= LINK_MAX_PAYLOAD; len++) {
+        int n = link_frame_encode(frame, LINK_FRAME_DATA, 0, payload, len);
+        int k = manch_encode(halves, frame, n);
+        uint64_t want = (uint64_t)k * manch_half_ns(bitrate);
+
+        CHECK(k <= MANCH_MAX_HALVES, "len %u: %d halves over MANCH_MAX_HALVES", len, k);
+        CHECK(manch_frame_ns(bitrate, len) == want, "len %u: manch_frame_ns %llu, encoded %llu",
+              len, (unsigned long long)manch_frame_ns(bitrate, len), (unsigned long long)want);
+    }
+}
+
+struct sent_frame {
+    uint8_t type, seq, len;
+    uint8_t payload[LINK_MAX_PAYLOAD];
+};
+
+// 프레임 nframes 개를 간격 없이 이어 보내고, 엣지마다 반비트의 ±jitter_pct%
+// 만큼 시각을 흔들어 디코더에 넣는다.
+static void check_round_trip(uint32_t bitrate, int nframes, int jitter_pct) {
+    static uint8_t halves[MANCH_MAX_HALVES];
+    struct sent_frame *sent = calloc(nframes, sizeof(*sent));
+    struct manch_decoder d;
+    uint8_t frame[LINK_MAX_FRAME];
+    uint64_t half = manch_half_ns(bitrate), t = 1000000000ull;
+    int level = 0, next = 0, ok = 0, bad = 0;
+
+    srand48(1);
+    manch_decoder_init(&d, bitrate);
+    for (int f = 0; f < nframes; f++) {
+        struct sent_frame *s = &sent[f];
+
+        s->type = 1 + (int)(drand48() * 3);
+        s->seq = f & 0xFF;
+        s->len = (int)(drand48() * (LINK_MAX_PAYLOAD + 1));
+        for (int i = 0; i < s->len; i++)
+            s->payload[i] = (uint8_t)(drand48() * 256);
+        int n = link_frame_encode(frame, s->type, s->seq, s->payload, s->len);
+        int k = manch_encode(halves, frame, n);
+
+        for (int j = 0; j < k; j++, t += half) {
+            if (halves[j] == level)
+                continue;
+            level = halves[j];
+            int64_t jitter = (int64_t)((drand48() * 2 - 1) * (double)half * jitter_pct / 100);
+            if (manch_decode_edge(&d, (uint64_t)((int64_t)t + jitter), level) != LINK_RX_FRAME)
+                continue;
+
+            // seq 로 보낸 프레임을 찾는다 (앞서 놓친 프레임은 건너뜀)
+            int idx = next + ((link_rx_seq(&d.rx) - next) & 0xFF);
+            const struct sent_frame *want = &sent[idx];
+            if (idx > f || link_rx_type(&d.rx) != want->type || link_rx_len(&d.rx) != want->len ||
+                memcmp(link_rx_payload(&d.rx), want->payload, want->len) != 0) {
+                bad++;
+                continue;
+            }
+            ok++;
+            next = idx + 1;
+        }
+    }
+
+    printf("round trip: %d/%d frames back to back at %u bit/s, jitter +-%d%% of a half-bit "
+           "(%u crc errors, %u code errors)\n",
+           ok, nframes, bitrate, jitter_pct, d.rx.crc_errors, d.code_errors);
+    CHECK(ok == nframes && bad == 0, "round trip decoded %d of %d frames, %d wrong", ok, nframes, bad);
+    free(sent);
+}
+
+int main(int argc, char *argv[]) {
+    int nframes = 1000, jitter_pct = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+            nframes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jitter") == 0 && i + 1 < argc) {
+            jitter_pct = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-frames N] [-jitter PCT]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (nframes < 1)
+        nframes = 1000;
+
+    check_crc();
+    check_delta();
+    check_frame_time(MANCH_MIN_BITRATE);
+    check_frame_time(MANCH_DEFAULT_BITRATE);
+    check_frame_time(MANCH_MAX_BITRATE);
+    check_round_trip(MANCH_DEFAULT_BITRATE, nframes, jitter_pct);
+
+    if (failures) {
+        fprintf(stderr, "link_check: %d checks FAILED\n", failures);
+        return 1;
+    }
+    printf("link_check: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+// link_frame.h - framing shared by the transmitters and count.ko
+//
+// On the wire, most significant bit first:
+//
+//   0xAA  0x7E  len  seq  type  payload[len]  crc_hi  crc_lo
+//
+// The preamble gives a receiver bit alignment, the sync byte marks the
+// frame start, and the CRC-16/CCITT-FALSE covers len..payload. Frames can
+// follow each other back to back; a receiver resynchronises on the next
+// preamble + sync after any error. The line code underneath (clocked
+// two-wire or Manchester) is up to the caller.
+#ifndef LINK_FRAME_H
+#define LINK_FRAME_H
+
+#include <linux/types.h>
+
+#define LINK_PREAMBLE     0xAA
+#define LINK_SYNC         0x7E
+#define LINK_MAX_PAYLOAD  64
+#define LINK_OVERHEAD     7         /* preamble, sync, len, seq, type, crc */
+#define LINK_MAX_FRAME    (LINK_MAX_PAYLOAD + LINK_OVERHEAD)
+
+enum link_frame_type {
+    LINK_FRAME_DATA = 1,            /* opaque bytes (e.g. a password) */
+    LINK_FRAME_EVENT = 2,           /* one byte: GPIO_SYM_ENTRY or GPIO_SYM_EXIT */
+    LINK_FRAME_DELTA = 3,           /* batched counts, see link_delta_encode() */
+};
+
+// DELTA payload, big-endian: batch seq (u16), entries (s16), exits (s16).
+// The batch seq counts DELTA frames only, so a receiver can tell how many
+// batches it missed independently of other traffic on the link.
+#define LINK_DELTA_LEN 6
+
+// link_rx_bit() results
+#define LINK_RX_NONE   0
+#define LINK_RX_FRAME  1            /* frame complete and CRC good */
+#define LINK_RX_BAD   (-1)          /* bad length or CRC, hunting again */
+
+static inline __u16 link_crc16(const __u8 *p, unsigned int n, __u16 crc) {
+    unsigned int i;
+    int b;
+
+    for (i = 0; i < n; i++) {
+        crc ^= (__u16)p[i] << 8;
+        for (b = 0; b < 8; b++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static inline void link_delta_encode(__u8 *p, __u16 seq, __s16 entries, __s16 exits) {
+    p[0] = seq >> 8;
+    p[1] = seq & 0xFF;
+    p[2] = (__u16)entries >> 8;
+    p[3] = (__u16)entries & 0xFF;
+    p[4] = (__u16)exits >> 8;
+    p[5] = (__u16)exits & 0xFF;
+}
+
+static inline void link_delta_decode(const __u8 *p, __u16 *seq, __s16 *entries, __s16 *exits) {
+    *seq = (__u16)(p[0] << 8 | p[1]);
+    *entries = (__s16)(p[2] << 8 | p[3]);
+    *exits = (__s16)(p[4] << 8 | p[5]);
+}
+
+// Builds a frame into out (LINK_MAX_FRAME bytes) and returns its length,
+// or -1 if the payload is too long.
+static inline int link_frame_encode(__u8 *out, __u8 type, __u8 seq,
+                                    const __u8 *payload, unsigned int len) {
+    __u16 crc;
+    unsigned int i;
+
+    if (len > LINK_MAX_PAYLOAD)
+        return -1;
+    out[0] = LINK_PREAMBLE;
+    out[1] = LINK_SYNC;
+    out[2] = (__u8)len;
+    out[3] = seq;
+    out[4] = type;
+    for (i = 0; i < len; i++)
+        out[5 + i] = payload[i];
+    crc = link_crc16(out + 2, len + 3, 0xFFFF);
+    out[5 + len] = crc >> 8;
+    out[6 + len] = crc & 0xFF;
+    return len + LINK_OVERHEAD;
+}
+
+// Bit-serial receiver. Hunts for preamble + sync in the bit stream, then
+// collects len, seq, type, payload and CRC into buf.
+struct link_rx {
+    __u16 shift;                    /* last 16 bits while hunting */
+    __u8 in_frame;
+    __u8 nbits;                     /* bits of the current byte */
+    __u8 pos;                       /* bytes collected since sync */
+    __u8 need;                      /* bytes expected since sync */
+    __u8 buf[LINK_MAX_FRAME];       /* len seq type payload crc_hi crc_lo */
+    __u32 frames;
+    __u32 crc_errors;
+};
+
+static inline void link_rx_reset(struct link_rx *rx) {
+    rx->shift = 0;
+    rx->in_frame = 0;
+}
+
+static inline __u8 link_rx_len(const struct link_rx *rx) { return rx->buf[0]; }
+static inline __u8 link_rx_seq(const struct link_rx *rx) { return rx->buf[1]; }
+static inline __u8 link_rx_type(const struct link_rx *rx) { return rx->buf[2]; }
+static inline const __u8 *link_rx_payload(const struct link_rx *rx) { return rx->buf + 3; }
+
+// Feeds one bit, most significant first. The completed frame stays in buf
+// until the next bit arrives.
+static inline int link_rx_bit(struct link_rx *rx, int bit) {
+    __u16 crc;
+
+    if (!rx->in_frame) {
+        rx->shift = (rx->shift << 1) | (bit & 1);
+        if (rx->shift == ((LINK_PREAMBLE << 8) | LINK_SYNC)) {
+            rx->in_frame = 1;
+            rx->nbits = 0;
+            rx->pos = 0;
+            rx->need = 1;
+        }
+        return LINK_RX_NONE;
+    }
+
+    if (rx->nbits == 0)
+        rx->buf[rx->pos] = 0;
+    rx->buf[rx->pos] = (rx->buf[rx->pos] << 1) | (bit & 1);
+    if (++rx->nbits < 8)
+        return LINK_RX_NONE;
+    rx->nbits = 0;
+    if (++rx->pos == 1) {
+        if (rx->buf[0] > LINK_MAX_PAYLOAD) {
+            link_rx_reset(rx);
+            rx->crc_errors++;
+            return LINK_RX_BAD;
+        }
+        rx->need = rx->buf[0] + 5;
+    }
+    if (rx->pos < rx->need)
+        return LINK_RX_NONE;
+
+    link_rx_reset(rx);
+    crc = link_crc16(rx->buf, rx->need - 2, 0xFFFF);
+    if (crc != ((rx->buf[rx->need - 2] << 8) | rx->buf[rx->need - 1])) {
+        rx->crc_errors++;
+        return LINK_RX_BAD;
+    }
+    rx->frames++;
+    return LINK_RX_FRAME;
+}
+
+#endif /* LINK_FRAME_H */
@@ -0,0 +1,98 @@
+// manchester.h - self-clocked single-wire line code shared by count.ko and
+// the userspace tools. IEEE 802.3 convention: every bit has a transition
+// in the middle, rising for 1 and falling for 0, so the receiver recovers
+// the clock from the data. The line idles low; link_frame.h frames ride on
+// top and their 0xAA preamble makes the first edge of a burst a mid-bit.
+#ifndef MANCHESTER_H
+#define MANCHESTER_H
+
+#include <linux/types.h>
+#include "link_frame.h"
+
+#define MANCH_DEFAULT_BITRATE 2000      /* bit/s */
+#define MANCH_MIN_BITRATE     100
+#define MANCH_MAX_BITRATE     10000     /* half-bit 50 us, well above IRQ latency */
+#define MANCH_GAP_HALVES      4         /* idle low after every frame, 2 bits */
+#define MANCH_MAX_HALVES      (LINK_MAX_FRAME * 16 + MANCH_GAP_HALVES)
+
+static inline __u32 manch_half_ns(__u32 bitrate) {
+    return 500000000u / bitrate;
+}
+
+// Line time of a frame with len payload bytes, trailing idle gap included.
+static inline __u64 manch_frame_ns(__u32 bitrate, unsigned int len) {
+    return (__u64)((len + LINK_OVERHEAD) * 16 + MANCH_GAP_HALVES) * manch_half_ns(bitrate);
+}
+
+// Expands bytes (msb first) into one line level per half-bit, followed by
+// MANCH_GAP_HALVES of idle low. The gap keeps the line quiet for well over
+// the decoder's 1.5-bit burst limit even if the last bit was a 0, so frames
+// may be sent back to back. Returns the number of halves
+// (<= MANCH_MAX_HALVES).
+static inline int manch_encode(__u8 *halves, const __u8 *bytes, int n) {
+    int i, b, k = 0;
+
+    for (i = 0; i < n; i++) {
+        for (b = 7; b >= 0; b--) {
+            int bit = (bytes[i] >> b) & 1;
+            halves[k++] = !bit;
+            halves[k++] = bit;
+        }
+    }
+    for (i = 0; i < MANCH_GAP_HALVES; i++)
+        halves[k++] = 0;
+    return k;
+}
+
+// Edge-timestamp decoder. Intervals of about half a bit and a whole bit are
+// the only legal ones inside a burst; anything longer than 1.5 bits ends
+// it. A short interval is a bit-boundary edge and must be followed by
+// another short one, which is then the mid-bit edge carrying the bit.
+// Timestamp error up to about a fifth of a half-bit per edge is tolerated.
+struct manch_decoder {
+    __u64 last_ns;
+    __u32 half_ns;
+    __u8 locked;                    /* last edge was a mid-bit */
+    __u8 boundary;                  /* last edge was a bit boundary */
+    __u32 code_errors;              /* illegal intervals inside a burst */
+    struct link_rx rx;
+};
+
+static inline void manch_decoder_init(struct manch_decoder *d, __u32 bitrate) {
+    *d = (struct manch_decoder){ .half_ns = manch_half_ns(bitrate) };
+}
+
+// Feeds one edge with the level after it. Returns a link_rx_bit() result;
+// on LINK_RX_FRAME the frame is in d->rx.
+static inline int manch_decode_edge(struct manch_decoder *d, __u64 now_ns, int level) {
+    __u64 dt = now_ns > d->last_ns ? now_ns - d->last_ns : 0;
+    __u32 half = d->half_ns;
+
+    d->last_ns = now_ns;
+    if (!d->locked || dt > 3ull * half) {
+        // Start of a burst: only a rising mid-bit (preamble 1) can open it.
+        if (d->locked && d->rx.in_frame)
+            d->code_errors++;
+        link_rx_reset(&d->rx);
+        d->boundary = 0;
+        d->locked = level != 0;
+        return d->locked ? link_rx_bit(&d->rx, 1) : LINK_RX_NONE;
+    }
+    if (dt < half / 2) {
+        d->code_errors++;
+        d->locked = 0;
+        return LINK_RX_NONE;
+    }
+    if (dt < 3 * half / 2) {
+        d->boundary = !d->boundary;
+        return d->boundary ? LINK_RX_NONE : link_rx_bit(&d->rx, level);
+    }
+    if (d->boundary) {
+        d->code_errors++;
+        d->locked = 0;
+        return LINK_RX_NONE;
+    }
+    return link_rx_bit(&d->rx, level);
+}
+
+#endif /* MANCHESTER_H */
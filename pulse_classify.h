@@ -0,0 +1,181 @@
+// pulse_classify.h - width-coded pulse classifier shared by count.ko and
+// the userspace replay tool. Header-only so both builds run identical code.
+#ifndef PULSE_CLASSIFY_H
+#define PULSE_CLASSIFY_H
+
+#include <linux/types.h>
+#include "sysprog_gpio.h"
+
+#ifdef __KERNEL__
+#include <linux/math64.h>
+#define PULSE_DIV_U64(a, b) div_u64((a), (b))
+#else
+#define PULSE_DIV_U64(a, b) ((a) / (b))
+#endif
+
+// Accept windows are exclusive on both ends: lo < width < hi.
+#define PULSE_ENTRY_LO_US  80000
+#define PULSE_ENTRY_HI_US 120000
+#define PULSE_EXIT_LO_US  180000
+#define PULSE_EXIT_HI_US  220000
+
+// Returned for a falling edge whose width matched no window.
+#define PULSE_REJECTED (-1)
+
+// Auto-calibration: a decaying width histogram is kept per line and every
+// PULSE_CALIB_PERIOD falling edges each window moves a step towards the
+// mean of the cluster around it, never further than max_shift_us from its
+// nominal centre. Window half-widths stay fixed. At the default (and
+// largest sensible) max_shift_us the entry and exit windows can just meet
+// at 150 ms but never overlap.
+#define PULSE_HIST_BUCKET_US   2000
+#define PULSE_HIST_BUCKETS     160          /* 0 .. 320 ms */
+#define PULSE_CALIB_PERIOD     64
+#define PULSE_CALIB_MIN_MASS   8            /* samples needed to move a window */
+#define PULSE_CALIB_MAX_SHIFT_US 30000
+
+struct pulse_window {
+    __u32 lo_us;
+    __u32 hi_us;
+};
+
+struct pulse_calib {
+    int enabled;
+    __u32 max_shift_us;
+    __u32 pending;                          /* samples since the last step */
+    __u16 hist[PULSE_HIST_BUCKETS];
+};
+
+struct pulse_classifier {
+    __u64 last_ns;
+    struct pulse_window entry;
+    struct pulse_window exit;
+    __u32 accepted;                         /* falling edges per outcome */
+    __u32 rejected;
+    struct pulse_calib calib;
+};
+
+static inline void pulse_classifier_reset_windows(struct pulse_classifier *pc) {
+    pc->entry.lo_us = PULSE_ENTRY_LO_US;
+    pc->entry.hi_us = PULSE_ENTRY_HI_US;
+    pc->exit.lo_us = PULSE_EXIT_LO_US;
+    pc->exit.hi_us = PULSE_EXIT_HI_US;
+}
+
+static inline void pulse_classifier_init(struct pulse_classifier *pc, __u64 now_ns) {
+    *pc = (struct pulse_classifier){ .last_ns = now_ns };
+    pc->calib.max_shift_us = PULSE_CALIB_MAX_SHIFT_US;
+    pulse_classifier_reset_windows(pc);
+}
+
+// Restarts edge timing (e.g. when the IRQ is re-enabled) but keeps the
+// calibrated windows and counters.
+static inline void pulse_classifier_restart(struct pulse_classifier *pc, __u64 now_ns) {
+    pc->last_ns = now_ns;
+}
+
+static inline __u32 pulse_reject_ppm(const struct pulse_classifier *pc) {
+    __u64 total = (__u64)pc->accepted + pc->rejected;
+    return total ? (__u32)PULSE_DIV_U64((__u64)pc->rejected * 1000000, total) : 0;
+}
+
+// One mean-shift step for window w, searching [lo, hi) in the histogram.
+static inline void pulse_calib_step(const struct pulse_calib *cal, struct pulse_window *w,
+                                    __u32 nominal_us, __u32 lo_us, __u32 hi_us) {
+    __u32 half = (w->hi_us - w->lo_us) / 2;
+    __u32 centre = w->lo_us + half;
+    __u64 sum = 0;
+    __u32 mass = 0, mean, b;
+    __u32 shift = cal->max_shift_us;
+
+    for (b = lo_us / PULSE_HIST_BUCKET_US; b < PULSE_HIST_BUCKETS &&
+         b * PULSE_HIST_BUCKET_US < hi_us; b++) {
+        sum += (__u64)cal->hist[b] * (b * PULSE_HIST_BUCKET_US + PULSE_HIST_BUCKET_US / 2);
+        mass += cal->hist[b];
+    }
+    if (mass < PULSE_CALIB_MIN_MASS)
+        return;
+
+    // Whatever max_shift_us says, lo_us must not go below zero.
+    if (shift > nominal_us - half)
+        shift = nominal_us - half;
+    mean = (__u32)PULSE_DIV_U64(sum, mass);
+    centre = (__u32)((int)centre + ((int)mean - (int)centre) / 4);
+    if (centre > nominal_us + shift)
+        centre = nominal_us + shift;
+    if (centre + shift < nominal_us)
+        centre = nominal_us - shift;
+    w->lo_us = centre - half;
+    w->hi_us = centre + half;
+}
+
+static inline void pulse_calib_update(struct pulse_classifier *pc, __u32 width_us) {
+    struct pulse_calib *cal = &pc->calib;
+    __u32 b = width_us / PULSE_HIST_BUCKET_US;
+    __u32 entry_c, exit_c, mid, reach, i;
+
+    if (b < PULSE_HIST_BUCKETS && cal->hist[b] < 0xffff)
+        cal->hist[b]++;
+    if (++cal->pending < PULSE_CALIB_PERIOD)
+        return;
+    cal->pending = 0;
+
+    // Search twice the half-width around each window, split at the midpoint
+    // so the two clusters never pull on the same samples.
+    entry_c = (pc->entry.lo_us + pc->entry.hi_us) / 2;
+    exit_c = (pc->exit.lo_us + pc->exit.hi_us) / 2;
+    mid = (entry_c + exit_c) / 2;
+    reach = pc->entry.hi_us - pc->entry.lo_us;
+    pulse_calib_step(cal, &pc->entry, (PULSE_ENTRY_LO_US + PULSE_ENTRY_HI_US) / 2,
+                     entry_c > reach ? entry_c - reach : 0,
+                     entry_c + reach < mid ? entry_c + reach : mid);
+    reach = pc->exit.hi_us - pc->exit.lo_us;
+    pulse_calib_step(cal, &pc->exit, (PULSE_EXIT_LO_US + PULSE_EXIT_HI_US) / 2,
+                     exit_c > mid + reach ? exit_c - reach : mid, exit_c + reach);
+
+    for (i = 0; i < PULSE_HIST_BUCKETS; i++)
+        cal->hist[i] /= 2;
+}
+
+// Forgets everything learned: nominal windows, empty histogram.
+static inline void pulse_calib_reset(struct pulse_classifier *pc) {
+    __u32 i;
+
+    pulse_classifier_reset_windows(pc);
+    pc->calib.pending = 0;
+    for (i = 0; i < PULSE_HIST_BUCKETS; i++)
+        pc->calib.hist[i] = 0;
+}
+
+static inline int pulse_window_match(const struct pulse_window *w, __u32 width_us) {
+    return width_us > w->lo_us && width_us < w->hi_us;
+}
+
+// Feeds one edge. The width is the time since the previous edge of either
+// polarity; only falling edges (level 0) are classified. Returns
+// GPIO_SYM_NONE for rising edges, GPIO_SYM_ENTRY/EXIT, or PULSE_REJECTED.
+static inline int pulse_classify_edge(struct pulse_classifier *pc, __u64 now_ns, int level,
+                                      __u32 *width_us) {
+    __u64 delta_ns = now_ns > pc->last_ns ? now_ns - pc->last_ns : 0;
+    __u64 delta_us = PULSE_DIV_U64(delta_ns, 1000);
+
+    pc->last_ns = now_ns;
+    *width_us = delta_us > 0xffffffffull ? 0xffffffffu : (__u32)delta_us;
+
+    if (level != 0)
+        return GPIO_SYM_NONE;
+    if (pc->calib.enabled)
+        pulse_calib_update(pc, *width_us);
+    if (pulse_window_match(&pc->exit, *width_us)) {
+        pc->accepted++;
+        return GPIO_SYM_EXIT;
+    }
+    if (pulse_window_match(&pc->entry, *width_us)) {
+        pc->accepted++;
+        return GPIO_SYM_ENTRY;
+    }
+    pc->rejected++;
+    return PULSE_REJECTED;
+}
+
+#endif /* PULSE_CLASSIFY_H */
@@ -0,0 +1,244 @@
+// replay.c - 캡처한 원시 엣지를 count.ko와 같은 분류기로 재생
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "sysprog_gpio.h"
+#include "pulse_classify.h"
+
+#define SYNTH_GAP_US 20000
+
+struct edge {
+    uint64_t ktime_ns;
+    int level;
+};
+
+struct symbol_at {
+    uint64_t ktime_ns;
+    int symbol;
+};
+
+struct trace {
+    struct edge *edges;
+    size_t nedges, edge_cap;
+    struct symbol_at *expected;     // 운영 중 기록된 (또는 합성 시 정답) 이벤트
+    size_t nexpected, expected_cap;
+};
+
+static void *grow(void *ptr, size_t *cap, size_t elem) {
+    *cap = *cap ? *cap * 2 : 4096;
+    ptr = realloc(ptr, *cap * elem);
+    if (ptr == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    return ptr;
+}
+
+static void add_edge(struct trace *t, uint64_t ns, int level) {
+    if (t->nedges == t->edge_cap)
+        t->edges = grow(t->edges, &t->edge_cap, sizeof(struct edge));
+    t->edges[t->nedges++] = (struct edge){ ns, level };
+}
+
+static void add_expected(struct trace *t, uint64_t ns, int symbol) {
+    if (t->nexpected == t->expected_cap)
+        t->expected = grow(t->expected, &t->expected_cap, sizeof(struct symbol_at));
+    t->expected[t->nexpected++] = (struct symbol_at){ ns, symbol };
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// rx -log 세그먼트 (또는 디바이스 스트림을 그대로 저장한 파일) 읽기
+int load_trace(const char *path, struct trace *t) {
+    struct gpio_event_header hdr;
+    struct gpio_event ev[1024];
+    size_t n;
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != GPIO_EVENT_MAGIC ||
+        hdr.version != GPIO_EVENT_VERSION || hdr.record_size != sizeof(struct gpio_event)) {
+        fprintf(stderr, "[REPLAY] %s: not a version %d event stream\n", path, GPIO_EVENT_VERSION);
+        fclose(f);
+        return -1;
+    }
+    while ((n = fread(ev, sizeof(ev[0]), 1024, f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (ev[i].ktime_ns == 0)        // 정상 종료되지 않은 세그먼트의 끝
+                break;
+            if (ev[i].symbol == GPIO_SYM_EDGE)
+                add_edge(t, ev[i].ktime_ns, ev[i].flags);
+            else if (ev[i].symbol == GPIO_SYM_ENTRY || ev[i].symbol == GPIO_SYM_EXIT)
+                add_expected(t, ev[i].ktime_ns, ev[i].symbol);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// 입장/퇴장 펄스를 섞은 합성 트레이스. 정답은 송신 의도 기호이며,
+// drift_us만큼 폭이 트레이스 끝까지 선형으로 밀린다 (온도/부하 드리프트).
+void synth_trace(struct trace *t, size_t pulses, int jitter_us, int drift_us) {
+    uint64_t ns = 1000000000ull;
+
+    for (size_t i = 0; i < pulses; i++) {
+        int is_entry = drand48() < 0.5;
+        int width = is_entry ? 100000 : 200000;
+        if (jitter_us > 0)
+            width += (int)(drand48() * (2 * jitter_us + 1)) - jitter_us;
+        width += (int)((double)drift_us * i / pulses);
+
+        ns += SYNTH_GAP_US * 1000ull;
+        add_edge(t, ns, 1);
+        ns += (uint64_t)width * 1000;
+        add_edge(t, ns, 0);
+        add_expected(t, ns, is_entry ? GPIO_SYM_ENTRY : GPIO_SYM_EXIT);
+    }
+}
+
+// 분류 결과를 out에 기록하고 분류된 이벤트 수를 반환
+size_t run_classifier(const struct trace *t, struct symbol_at *out, struct pulse_classifier *result,
+                      int calibrate) {
+    struct pulse_classifier pc;
+    size_t n = 0;
+    uint32_t width;
+
+    pulse_classifier_init(&pc, t->nedges ? t->edges[0].ktime_ns : 0);
+    pc.calib.enabled = calibrate;
+    for (size_t i = 0; i < t->nedges; i++) {
+        int sym = pulse_classify_edge(&pc, t->edges[i].ktime_ns, t->edges[i].level, &width);
+        if (sym == GPIO_SYM_ENTRY || sym == GPIO_SYM_EXIT) {
+            out[n].ktime_ns = t->edges[i].ktime_ns;
+            out[n].symbol = sym;
+            n++;
+        }
+    }
+    *result = pc;
+    return n;
+}
+
+static long net_count(const struct symbol_at *s, size_t n) {
+    long net = 0;
+    for (size_t i = 0; i < n; i++)
+        net += s[i].symbol == GPIO_SYM_ENTRY ? 1 : -1;
+    return net;
+}
+
+// 같은 엣지 시각에 같은 기호가 나온 이벤트 수 (둘 다 시간순)
+static size_t count_agreement(const struct symbol_at *a, size_t na,
+                              const struct symbol_at *b, size_t nb) {
+    size_t i = 0, j = 0, match = 0;
+
+    while (i < na && j < nb) {
+        if (a[i].ktime_ns < b[j].ktime_ns) {
+            i++;
+        } else if (a[i].ktime_ns > b[j].ktime_ns) {
+            j++;
+        } else {
+            match += a[i].symbol == b[j].symbol;
+            i++;
+            j++;
+        }
+    }
+    return match;
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s [-repeat K] SEGMENT...\n", prog);
+    printf("       %s -synthetic PULSES [-jitter US] [-drift US] [-seed N] [-repeat K]\n", prog);
+    printf("       -calibrate  enable adaptive window calibration\n");
+}
+
+int main(int argc, char *argv[]) {
+    struct trace t = { 0 };
+    size_t synth = 0;
+    int jitter_us = 0, drift_us = 0, repeat = 1, nfiles = 0, calibrate = 0;
+    long seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-synthetic") == 0 && i + 1 < argc) {
+            synth = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-jitter") == 0 && i + 1 < argc) {
+            jitter_us = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-drift") == 0 && i + 1 < argc) {
+            drift_us = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-calibrate") == 0) {
+            calibrate = 1;
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            if (load_trace(argv[i], &t) < 0)
+                return 1;
+            nfiles++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (synth) {
+        srand48(seed);
+        synth_trace(&t, synth, jitter_us, drift_us);
+    } else if (nfiles == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (t.nedges == 0) {
+        fprintf(stderr, "[REPLAY] No raw edges in trace (was capture enabled?)\n");
+        return 1;
+    }
+    if (repeat < 1)
+        repeat = 1;
+
+    struct symbol_at *got = malloc(t.nedges * sizeof(*got));
+    if (got == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    struct pulse_classifier pc;
+    size_t ngot = 0;
+    uint64_t start = now_ns();
+    for (int r = 0; r < repeat; r++)
+        ngot = run_classifier(&t, got, &pc, calibrate);
+    double secs = (now_ns() - start) / 1e9;
+
+    // 캡처 구간 안에서 기록된 이벤트만 비교 대상
+    uint64_t first = t.edges[0].ktime_ns, last = t.edges[t.nedges - 1].ktime_ns;
+    size_t lo = 0, hi = t.nexpected;
+    while (lo < hi && t.expected[lo].ktime_ns <= first)
+        lo++;
+    while (hi > lo && t.expected[hi - 1].ktime_ns > last)
+        hi--;
+    size_t nexp = hi - lo;
+    size_t match = count_agreement(got, ngot, t.expected + lo, nexp);
+    size_t denom = ngot > nexp ? ngot : nexp;
+
+    printf("[REPLAY] %zu edges x %d in %.3f s: %.0f edges/s, %.0f events/s, %.1f ns/edge\n",
+           t.nedges, repeat, secs, t.nedges * repeat / secs, ngot * repeat / secs,
+           secs * 1e9 / ((double)t.nedges * repeat));
+    printf("[REPLAY] %s: %zu events, replay: %zu events, agreement %zu/%zu (%.2f%%)\n",
+           synth ? "expected" : "production", nexp, ngot, match, denom,
+           denom ? 100.0 * match / denom : 100.0);
+    printf("[REPLAY] net count: %s %+ld, replay %+ld\n",
+           synth ? "expected" : "production", net_count(t.expected + lo, nexp),
+           net_count(got, ngot));
+    printf("[REPLAY] reject rate %u ppm, final windows entry %u-%u exit %u-%u us\n",
+           pulse_reject_ppm(&pc), pc.entry.lo_us, pc.entry.hi_us, pc.exit.lo_us, pc.exit.hi_us);
+
+    free(got);
+    free(t.edges);
+    free(t.expected);
+    return 0;
+}
@@ -1,4 +1,5 @@
 // rx.c
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -9,13 +10,35 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/gpio.h>
+
+#include "sysprog_gpio.h"
+#include "pulse_classify.h"
+#include "manchester.h"
 
-#define GPIO_IOCTL_MAGIC       'G'
-#define GPIO_IOCTL_ENABLE_IRQ  _IOW(GPIO_IOCTL_MAGIC, 1, int)
-#define GPIO_IOCTL_DISABLE_IRQ _IOW(GPIO_IOCTL_MAGIC, 2, int)
-#define GPIO_IOCTL_GET_COUNT   _IOR(GPIO_IOCTL_MAGIC, 3, int)
 #define DEFAULT_GPIO_DEV "/dev/gpio17"
 
+// 로그 모드 기본값
+#define LOG_SEGMENT_DEFAULT_MB 64
+#define LOG_ROTATE_DEFAULT_SEC 3600
+#define LOG_READ_BATCH         4096   // read() 한 번에 받는 최대 레코드 수
+#define LOG_INDEX_NAME         "index"
+
+// 서버 모드 설정
+#define SERVE_MAX_CLIENTS      64
+#define SERVE_CLIENT_BUF       (64 * 1024)  // 이보다 밀린 클라이언트는 끊는다
+#define SERVE_READ_BATCH       1024
+
+// gpiochip 백엔드 설정
+#define CHIP_READ_BATCH        64     // read() 한 번에 받는 최대 엣지 이벤트 수
+#define CHIP_EVENT_BUFFER      1024   // 커널 쪽 엣지 이벤트 큐 길이
+
 static volatile int running = 1;
 static int gpio_fd = -1;
 
@@ -45,6 +68,465 @@ int get_current_count(int fd) {
     return count;
 }
 
+// ---- 바이너리 이벤트 로거 ----
+//
+// 세그먼트 파일은 gpio_event_header + gpio_event 레코드의 연속으로,
+// 드라이버가 read()로 내주는 스트림과 같은 형식이다. 파일을 미리 할당해
+// mmap한 뒤 read()가 매핑된 영역에 직접 쓰도록 하므로 이벤트마다
+// 시스템 콜이나 stdio 포맷팅이 없다. 정상 종료되지 않은 세그먼트는
+// ktime_ns가 0인 첫 레코드에서 끝난다.
+
+struct log_segment {
+    int fd;
+    unsigned int index;
+    char *base;
+    size_t size;
+    size_t used;
+    unsigned long records;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    time_t opened;
+};
+
+static time_t monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+// 다음 세그먼트 파일 생성 (기존 파일은 덮어쓰지 않음)
+int log_segment_open(const char *dir, struct log_segment *seg, unsigned int index, size_t size) {
+    char path[512];
+    int fd, err;
+
+    for (;; index++) {
+        snprintf(path, sizeof(path), "%s/seg_%06u.gev", dir, index);
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0 || errno != EEXIST)
+            break;
+    }
+    if (fd < 0) {
+        perror("open segment");
+        return -1;
+    }
+
+    err = posix_fallocate(fd, 0, size);
+    if (err) {
+        fprintf(stderr, "[RX] posix_fallocate %s: %s\n", path, strerror(err));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    seg->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (seg->base == MAP_FAILED) {
+        perror("mmap segment");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    seg->fd = fd;
+    seg->index = index;
+    seg->size = size;
+    seg->used = 0;
+    seg->records = 0;
+    seg->first_ns = 0;
+    seg->last_ns = 0;
+    seg->opened = monotonic_seconds();
+    return 0;
+}
+
+// 세그먼트를 실제 길이로 자르고 인덱스에 시간 범위 기록
+void log_segment_close(const char *dir, struct log_segment *seg) {
+    char path[512];
+
+    munmap(seg->base, seg->size);
+    if (ftruncate(seg->fd, seg->used) < 0)
+        perror("ftruncate segment");
+    fsync(seg->fd);
+    close(seg->fd);
+    seg->fd = -1;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, LOG_INDEX_NAME);
+    int idx_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (idx_fd < 0) {
+        perror("open index");
+        return;
+    }
+    dprintf(idx_fd, "seg_%06u.gev %llu %llu %lu\n", seg->index,
+            (unsigned long long)seg->first_ns, (unsigned long long)seg->last_ns,
+            seg->records);
+    close(idx_fd);
+}
+
+int log_mode(int fd, const char *dir, size_t seg_size, int rotate_sec) {
+    const size_t rec = sizeof(struct gpio_event);
+    struct gpio_event_header hdr;
+    struct log_segment seg;
+    unsigned long total = 0, lost = 0;
+    uint32_t next_seq = 0;
+    int have_seq = 0;
+
+    if (seg_size < sizeof(hdr) + rec) {
+        fprintf(stderr, "[RX] Segment size too small\n");
+        return -1;
+    }
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir");
+        return -1;
+    }
+
+    // 첫 read()는 스트림 헤더를 돌려준다
+    if (read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+        perror("read header");
+        return -1;
+    }
+    if (hdr.magic != GPIO_EVENT_MAGIC || hdr.version != GPIO_EVENT_VERSION ||
+        hdr.record_size != rec) {
+        fprintf(stderr, "[RX] Unsupported event stream (magic 0x%08x, version %u)\n",
+                hdr.magic, hdr.version);
+        return -1;
+    }
+
+    if (log_segment_open(dir, &seg, 1, seg_size) < 0)
+        return -1;
+    memcpy(seg.base, &hdr, sizeof(hdr));
+    seg.used = sizeof(hdr);
+
+    printf("[RX] Logging to %s (segment %zu bytes, rotate %d s)\n", dir, seg_size, rotate_sec);
+    fflush(stdout);
+
+    while (running) {
+        size_t room = (seg.size - seg.used) / rec;
+        if (room == 0 || (seg.records && monotonic_seconds() - seg.opened >= rotate_sec)) {
+            unsigned int next = seg.index + 1;
+            log_segment_close(dir, &seg);
+            if (log_segment_open(dir, &seg, next, seg_size) < 0)
+                return -1;
+            memcpy(seg.base, &hdr, sizeof(hdr));
+            seg.used = sizeof(hdr);
+            continue;
+        }
+        if (room > LOG_READ_BATCH)
+            room = LOG_READ_BATCH;
+
+        // 레코드가 든 세그먼트는 조용한 라인에서도 제때 돌리도록
+        // 회전 시각까지 남은 만큼만 기다린다
+        int timeout_ms = -1;
+        if (seg.records) {
+            time_t left = rotate_sec - (monotonic_seconds() - seg.opened);
+            if (left > 3600)
+                left = 3600;                // int 밀리초 범위 안에서 나눠 기다림
+            timeout_ms = left > 0 ? (int)left * 1000 : 0;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll events");
+            break;
+        }
+        if (ready == 0)
+            continue;       // 회전 시각 도달
+
+        // 매핑된 세그먼트로 직접 읽기
+        ssize_t n = read(fd, seg.base + seg.used, room * rec);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("read events");
+            break;
+        }
+        if (n == 0) {       // 라인이 unexport됨
+            printf("[RX] Line removed, stopping log\n");
+            break;
+        }
+
+        struct gpio_event *ev = (struct gpio_event *)(seg.base + seg.used);
+        size_t cnt = n / rec;
+        for (size_t i = 0; i < cnt; i++) {
+            if (have_seq && ev[i].seq != next_seq)
+                lost += ev[i].seq - next_seq;
+            next_seq = ev[i].seq + 1;
+            have_seq = 1;
+        }
+        if (cnt) {
+            if (!seg.records)
+                seg.first_ns = ev[0].ktime_ns;
+            seg.last_ns = ev[cnt - 1].ktime_ns;
+        }
+        seg.used += cnt * rec;
+        seg.records += cnt;
+        total += cnt;
+    }
+
+    log_segment_close(dir, &seg);
+    printf("[RX] Logged %lu records, %lu lost\n", total, lost);
+    return 0;
+}
+
+// ---- 카운트 서버 ----
+//
+// 디바이스를 단독으로 열고 IRQ를 소유한 채, 현재 값은 공유 메모리
+// 스냅샷으로, 이벤트 스트림은 Unix 도메인 소켓으로 여러 클라이언트에
+// 나눠준다. 디바이스에서 한 번에 읽은 배치는 클라이언트마다 write()
+// 한 번으로 전달되므로 클라이언트당 깨어남은 배치당 최대 한 번이다.
+
+struct serve_client {
+    int fd;
+    size_t len;
+    char buf[SERVE_CLIENT_BUF];
+};
+
+static struct serve_client *clients[SERVE_MAX_CLIENTS];
+static volatile struct count_snapshot *snapshot;
+
+static void snapshot_update(const struct gpio_event *ev, size_t cnt, unsigned int nclients) {
+    __atomic_store_n(&snapshot->seq, snapshot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (cnt) {
+        snapshot->count = ev[cnt - 1].count_after;
+        snapshot->last_event_ns = ev[cnt - 1].ktime_ns;
+        snapshot->last_seq = ev[cnt - 1].seq;
+        snapshot->events += cnt;
+    }
+    snapshot->clients = nclients;
+    __atomic_store_n(&snapshot->seq, snapshot->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void client_drop(int epfd, int slot) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, clients[slot]->fd, NULL);
+    close(clients[slot]->fd);
+    free(clients[slot]);
+    clients[slot] = NULL;
+}
+
+// 밀린 데이터를 가능한 만큼 보내고, 남으면 EPOLLOUT을 기다린다
+static int client_flush(int epfd, int slot) {
+    struct serve_client *c = clients[slot];
+    struct epoll_event ee = { .data.u32 = slot + 2 };
+
+    while (c->len) {
+        ssize_t n = send(c->fd, c->buf, c->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN)
+                return -1;
+            break;
+        }
+        memmove(c->buf, c->buf + n, c->len - n);
+        c->len -= n;
+    }
+    ee.events = c->len ? EPOLLOUT : 0;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ee);
+    return 0;
+}
+
+static int client_queue(int epfd, int slot, const void *data, size_t len) {
+    struct serve_client *c = clients[slot];
+
+    if (c->len + len > sizeof(c->buf))
+        return -1;
+    memcpy(c->buf + c->len, data, len);
+    c->len += len;
+    return client_flush(epfd, slot);
+}
+
+int serve_mode(int fd, const char *sock_path) {
+    static struct gpio_event batch[SERVE_READ_BATCH];
+    struct gpio_event_header hdr;
+    struct epoll_event ee, events[16];
+    struct sockaddr_un addr;
+    unsigned int nclients = 0;
+    int listen_fd, shm_fd, epfd, ret = -1;
+
+    if (read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+        perror("read header");
+        return -1;
+    }
+    // 이벤트 루프가 디바이스 read()에서 막히지 않도록 논블로킹으로 전환
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        perror("fcntl O_NONBLOCK");
+        return -1;
+    }
+
+    shm_fd = shm_open(COUNT_SHM_NAME, O_RDWR | O_CREAT, 0644);
+    if (shm_fd < 0 || ftruncate(shm_fd, sizeof(struct count_snapshot)) < 0) {
+        perror("shm_open");
+        return -1;
+    }
+    snapshot = mmap(NULL, sizeof(struct count_snapshot), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (snapshot == MAP_FAILED) {
+        perror("mmap snapshot");
+        return -1;
+    }
+    memset((void *)snapshot, 0, sizeof(struct count_snapshot));
+    snapshot->count = get_current_count(fd);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        goto out_shm;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+    unlink(sock_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, SERVE_MAX_CLIENTS) < 0) {
+        perror("bind");
+        goto out_sock;
+    }
+
+    // data.u32: 0 = 디바이스, 1 = 리슨 소켓, 2.. = 클라이언트 슬롯
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        goto out_unlink;
+    }
+    ee.events = EPOLLIN;
+    ee.data.u32 = 0;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ee) < 0) {
+        perror("epoll_ctl device");
+        goto out_epoll;
+    }
+    ee.data.u32 = 1;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ee) < 0) {
+        perror("epoll_ctl listen");
+        goto out_epoll;
+    }
+
+    printf("[RX] Serving count on %s (snapshot shm %s)\n", sock_path, COUNT_SHM_NAME);
+    fflush(stdout);
+
+    while (running) {
+        int n = epoll_wait(epfd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint32_t id = events[i].data.u32;
+
+            if (id == 0) {
+                ssize_t len = read(fd, batch, sizeof(batch));
+                if (len < 0) {
+                    if (errno == EAGAIN || errno == EINTR)
+                        continue;
+                    perror("read events");
+                    running = 0;
+                    break;
+                }
+                if (len == 0) {     // EOF (EPOLLHUP): 라인이 unexport됨
+                    printf("[RX] Line removed, stopping server\n");
+                    running = 0;
+                    break;
+                }
+                snapshot_update(batch, len / sizeof(batch[0]), nclients);
+                for (int slot = 0; slot < SERVE_MAX_CLIENTS; slot++) {
+                    if (clients[slot] && client_queue(epfd, slot, batch, len) < 0) {
+                        client_drop(epfd, slot);
+                        nclients--;
+                    }
+                }
+            } else if (id == 1) {
+                int cfd;
+                while ((cfd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int slot;
+                    for (slot = 0; slot < SERVE_MAX_CLIENTS && clients[slot]; slot++)
+                        ;
+                    if (slot == SERVE_MAX_CLIENTS || !(clients[slot] = malloc(sizeof(struct serve_client)))) {
+                        close(cfd);
+                        continue;
+                    }
+                    clients[slot]->fd = cfd;
+                    clients[slot]->len = 0;
+                    ee.events = 0;
+                    ee.data.u32 = slot + 2;
+                    if (epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &ee) < 0) {
+                        perror("epoll_ctl client");
+                        client_drop(epfd, slot);
+                        continue;
+                    }
+                    nclients++;
+                    client_queue(epfd, slot, &hdr, sizeof(hdr));
+                }
+                snapshot_update(NULL, 0, nclients);
+            } else {
+                int slot = id - 2;
+                if (!clients[slot])
+                    continue;
+                if ((events[i].events & (EPOLLERR | EPOLLHUP)) || client_flush(epfd, slot) < 0) {
+                    client_drop(epfd, slot);
+                    nclients--;
+                    snapshot_update(NULL, 0, nclients);
+                }
+            }
+        }
+    }
+
+    ret = 0;
+    for (int slot = 0; slot < SERVE_MAX_CLIENTS; slot++) {
+        if (clients[slot])
+            client_drop(epfd, slot);
+    }
+out_epoll:
+    close(epfd);
+out_unlink:
+    unlink(sock_path);
+out_sock:
+    close(listen_fd);
+out_shm:
+    munmap((void *)snapshot, sizeof(struct count_snapshot));
+    shm_unlink(COUNT_SHM_NAME);
+    return ret;
+}
+
+// 라인 속성 쓰기 (/dev/gpioN -> /sys/class/sysprog_gpio/gpioN/ATTR)
+int set_line_attr(const char *dev_path, const char *attr, const char *value) {
+    char path[128];
+    const char *name = strrchr(dev_path, '/');
+    size_t len = strlen(value);
+
+    snprintf(path, sizeof(path), "/sys/class/sysprog_gpio/%s/%s", name ? name + 1 : dev_path, attr);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0 || write(fd, value, len) != (ssize_t)len) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+// 원시 엣지 캡처 켜기/끄기
+int set_capture(const char *dev_path, int on) {
+    return set_line_attr(dev_path, "capture", on ? "1" : "0");
+}
+
+// 맨체스터 수신: 부호화와 비트레이트는 IRQ가 꺼져 있을 때만 바뀌므로
+// ENABLE_IRQ 전에 tx -manchester 와 같은 순서로 쓴다
+int set_manchester(const char *dev_path, unsigned int bitrate) {
+    char rate[16];
+
+    snprintf(rate, sizeof(rate), "%u", bitrate);
+    if (set_line_attr(dev_path, "bitrate", rate) < 0 ||
+        set_line_attr(dev_path, "encoding", "manchester") < 0)
+        return -1;
+    printf("[RX] Manchester link at %u bit/s\n", bitrate);
+    return 0;
+}
+
 // 정리 함수
 void cleanup() {
     if (gpio_fd >= 0) {
@@ -56,21 +538,191 @@ void cleanup() {
     }
 }
 
+// ---- GPIO 문자 디바이스 (uAPI v2) 백엔드 ----
+//
+// count.ko 없이 /dev/gpiochipN의 라인을 양쪽 엣지 입력으로 요청하고,
+// 커널이 타임스탬프를 찍어 큐에 쌓은 엣지 이벤트를 묶음으로 읽어
+// count.ko와 같은 분류기(pulse_classify.h)로 입장/퇴장을 판정한다.
+// gpio-sim 라인에도 그대로 쓸 수 있어 count.ko 경로와 비교 측정이 가능하다.
+
+int chip_request_line(const char *chip_path, unsigned int line) {
+    struct gpio_v2_line_request req;
+    int chip_fd = open(chip_path, O_RDONLY | O_CLOEXEC);
+
+    if (chip_fd < 0) {
+        perror(chip_path);
+        return -1;
+    }
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    req.event_buffer_size = CHIP_EVENT_BUFFER;
+    strncpy(req.consumer, "sysprog-rx", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+                       GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        perror("ioctl - get line");
+        close(chip_fd);
+        return -1;
+    }
+    close(chip_fd);
+    return req.fd;
+}
+
+int chip_mode(const char *chip_path, unsigned int line) {
+    struct gpio_v2_line_event ev[CHIP_READ_BATCH];
+    struct pulse_classifier pc;
+    unsigned long edges = 0, entries = 0, exits = 0, reads = 0, lost = 0;
+    uint64_t lat_sum = 0, lat_max = 0;
+    uint32_t next_seqno = 0, width_us;
+    int count = 0;
+    char timestamp[16];
+
+    int fd = chip_request_line(chip_path, line);
+    if (fd < 0)
+        return -1;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t start = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    pulse_classifier_init(&pc, start);
+
+    printf("[RX] People Counter Monitor Started (gpiochip backend)\n");
+    printf("[RX] Line: %s offset %u\n", chip_path, line);
+    printf("=====================================\n");
+
+    while (running) {
+        ssize_t n = read(fd, ev, sizeof(ev));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("read line events");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t now = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        reads++;
+
+        for (size_t i = 0; i < n / sizeof(ev[0]); i++) {
+            // 라인 seqno가 건너뛰면 커널 큐가 넘쳐 엣지를 잃은 것
+            if (next_seqno && ev[i].line_seqno != next_seqno)
+                lost += ev[i].line_seqno - next_seqno;
+            next_seqno = ev[i].line_seqno + 1;
+
+            uint64_t lat = now > ev[i].timestamp_ns ? now - ev[i].timestamp_ns : 0;
+            lat_sum += lat;
+            if (lat > lat_max)
+                lat_max = lat;
+            edges++;
+
+            int level = ev[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+            int sym = pulse_classify_edge(&pc, ev[i].timestamp_ns, level, &width_us);
+            if (sym != GPIO_SYM_ENTRY && sym != GPIO_SYM_EXIT)
+                continue;
+            get_timestamp(timestamp, sizeof(timestamp));
+            if (sym == GPIO_SYM_ENTRY) {
+                entries++;
+                printf("%s | 👤➡️  ENTRY detected | Count: %d (%u us)\n", timestamp, ++count, width_us);
+            } else {
+                exits++;
+                printf("%s | 👤⬅️  EXIT detected  | Count: %d (%u us)\n", timestamp, --count, width_us);
+            }
+        }
+        fflush(stdout);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double secs = ((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec - start) / 1e9;
+    printf("\n[RX] %lu edges in %lu reads (%.1f/read), %lu lost, %.1f edges/s\n", edges, reads,
+           reads ? (double)edges / reads : 0.0, lost, secs > 0 ? edges / secs : 0.0);
+    printf("[RX] entry %lu, exit %lu, count %d, reject rate %u ppm\n",
+           entries, exits, count, pulse_reject_ppm(&pc));
+    printf("[RX] edge-to-userspace latency avg %.1f us, max %.1f us\n",
+           edges ? lat_sum / 1e3 / edges : 0.0, lat_max / 1e3);
+    close(fd);
+    return 0;
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s [device_path] [-log DIR] [-segsize MB] [-rotate SEC] [-capture] [-serve [-sock PATH]]\n"
+           "          [-manchester BITRATE]\n", prog);
+    printf("  -log DIR      Append binary event records to rotating segments in DIR\n");
+    printf("  -segsize MB   Preallocated segment size (default %d)\n", LOG_SEGMENT_DEFAULT_MB);
+    printf("  -rotate SEC   Start a new segment after SEC seconds (default %d)\n", LOG_ROTATE_DEFAULT_SEC);
+    printf("  -capture      Also record every raw edge (for replay; with -log or -serve)\n");
+    printf("  -serve        Run as count server for local clients\n");
+    printf("  -manchester BITRATE  Decode link frames (%d..%d bit/s) instead of pulses\n",
+           MANCH_MIN_BITRATE, MANCH_MAX_BITRATE);
+    printf("  -sock PATH    Server socket path (default %s)\n", COUNT_SOCKET_PATH);
+    printf("       %s -chip /dev/gpiochipN -line N\n", prog);
+    printf("  -chip PATH    Use the GPIO character device instead of count.ko\n");
+    printf("  -line N       Line offset on that chip\n");
+}
+
 int main(int argc, char *argv[]) {
     const char *dev_path = DEFAULT_GPIO_DEV;
+    const char *log_dir = NULL;
+    const char *serve_path = NULL;
+    size_t seg_mb = LOG_SEGMENT_DEFAULT_MB;
+    int rotate_sec = LOG_ROTATE_DEFAULT_SEC;
+    const char *chip_path = NULL;
+    int chip_line = -1;
+    int have_dev = 0;
+    int capture = 0;
+    unsigned int link_bitrate = 0;
     char timestamp[16];
 
-    if (argc >= 2) {
-        dev_path = argv[1];
-    } else {
-        printf("Usage: %s [device_path]\n", argv[0]);
+    // 명령행 인수 처리
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-log") == 0 && i + 1 < argc) {
+            log_dir = argv[++i];
+        } else if (strcmp(argv[i], "-serve") == 0) {
+            if (!serve_path)
+                serve_path = COUNT_SOCKET_PATH;
+        } else if (strcmp(argv[i], "-capture") == 0) {
+            capture = 1;
+        } else if (strcmp(argv[i], "-sock") == 0 && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (strcmp(argv[i], "-segsize") == 0 && i + 1 < argc) {
+            seg_mb = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-rotate") == 0 && i + 1 < argc) {
+            rotate_sec = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-manchester") == 0 && i + 1 < argc) {
+            link_bitrate = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-chip") == 0 && i + 1 < argc) {
+            chip_path = argv[++i];
+        } else if (strcmp(argv[i], "-line") == 0 && i + 1 < argc) {
+            chip_line = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !have_dev) {
+            dev_path = argv[i];
+            have_dev = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((link_bitrate && (link_bitrate < MANCH_MIN_BITRATE || link_bitrate > MANCH_MAX_BITRATE)) ||
+        (chip_path && (chip_line < 0 || have_dev || log_dir || serve_path || capture || link_bitrate)) ||
+        (capture && !log_dir && !serve_path)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!have_dev && !chip_path) {
+        print_usage(argv[0]);
         printf("Using default: %s\n", dev_path);
     }
 
-    // 신호 핸들러 등록
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    signal(SIGIO, signal_handler);
+    // 신호 핸들러 등록 (SA_RESTART 없이: 블로킹 read()가 종료 신호에 깨어나도록)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGIO, &sa, NULL);
+
+    if (chip_path)
+        return chip_mode(chip_path, chip_line) < 0 ? 1 : 0;
 
     // GPIO 디바이스 열기
     gpio_fd = open(dev_path, O_RDONLY);
@@ -79,6 +731,11 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (link_bitrate && set_manchester(dev_path, link_bitrate) < 0) {
+        close(gpio_fd);
+        return 1;
+    }
+
     // IRQ 활성화
     int dummy = 0;
     if (ioctl(gpio_fd, GPIO_IOCTL_ENABLE_IRQ, &dummy) < 0) {
@@ -87,6 +744,19 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (log_dir || serve_path) {
+        if (capture && set_capture(dev_path, 1) < 0) {
+            cleanup();
+            return 1;
+        }
+        int ret = log_dir ? log_mode(gpio_fd, log_dir, seg_mb << 20, rotate_sec)
+                          : serve_mode(gpio_fd, serve_path);
+        if (capture)
+            set_capture(dev_path, 0);
+        cleanup();
+        return ret < 0 ? 1 : 0;
+    }
+
     // 비동기 신호 설정
     if (fcntl(gpio_fd, F_SETOWN, getpid()) < 0) {
         perror("fcntl F_SETOWN");
@@ -134,6 +804,17 @@ int main(int argc, char *argv[]) {
             last_displayed_count = current_count;
             fflush(stdout);
         }
+
+        // 맨체스터 링크로 받은 DATA 프레임 (비어 있으면 EAGAIN)
+        struct gpio_link_frame frame;
+        while (ioctl(gpio_fd, GPIO_IOCTL_RX_FRAME, &frame) == 0) {
+            get_timestamp(timestamp, sizeof(timestamp));
+            printf("%s | 📨 DATA frame seq %u (%u bytes): ", timestamp, frame.seq, frame.len);
+            for (int i = 0; i < frame.len; i++)
+                putchar(frame.payload[i] >= 0x20 && frame.payload[i] < 0x7f ? frame.payload[i] : '.');
+            putchar('\n');
+            fflush(stdout);
+        }
     }
 
     cleanup();
@@ -0,0 +1,162 @@
+// sysprog_gpio.h - interface shared by count.ko and the user programs
+#ifndef SYSPROG_GPIO_H
+#define SYSPROG_GPIO_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// ENABLE_IRQ/DISABLE_IRQ take and drop the calling file's reference on the
+// line's IRQ; it stays on while any open file holds one.
+#define GPIO_IOCTL_MAGIC       'G'
+#define GPIO_IOCTL_ENABLE_IRQ  _IOW(GPIO_IOCTL_MAGIC, 1, int)
+#define GPIO_IOCTL_DISABLE_IRQ _IOW(GPIO_IOCTL_MAGIC, 2, int)
+#define GPIO_IOCTL_GET_COUNT   _IOR(GPIO_IOCTL_MAGIC, 3, int)
+#define GPIO_IOCTL_LA_START    _IOW(GPIO_IOCTL_MAGIC, 4, __u32)  /* arg: edge slots */
+#define GPIO_IOCTL_LA_STOP     _IO(GPIO_IOCTL_MAGIC, 5)
+#define GPIO_IOCTL_TX_FRAME    _IOW(GPIO_IOCTL_MAGIC, 6, struct gpio_link_frame)
+#define GPIO_IOCTL_RX_FRAME    _IOR(GPIO_IOCTL_MAGIC, 7, struct gpio_link_frame)
+
+// ---- EVENT RECORD FORMAT ----
+//
+// read() on /dev/gpioN returns one struct gpio_event_header at file
+// offset 0, followed by a stream of fixed-size struct gpio_event records.
+// A log file is the same byte stream written to disk unchanged.
+
+#define GPIO_EVENT_MAGIC   0x54564547u  /* "GEVT" little-endian */
+#define GPIO_EVENT_VERSION 1
+
+enum gpio_event_symbol {
+    GPIO_SYM_NONE  = 0,
+    GPIO_SYM_ENTRY = 1,
+    GPIO_SYM_EXIT  = 2,
+    GPIO_SYM_EDGE  = 3,  /* raw edge (capture mode): flags = level,
+                            width_us = time since the previous edge */
+    GPIO_SYM_FRAME = 4,  /* link frame queued for GPIO_IOCTL_RX_FRAME:
+                            flags = frame type, width_us = payload length */
+    GPIO_SYM_DELTA = 5,  /* batched counts applied at once: width_us packs
+                            entries (low s16) and exits (high s16), flags
+                            has GPIO_EV_SEQ_GAP if batches were missed */
+};
+
+#define GPIO_EV_SEQ_GAP 0x01
+
+struct gpio_event_header {
+    __u32 magic;        /* GPIO_EVENT_MAGIC */
+    __u16 version;      /* GPIO_EVENT_VERSION */
+    __u16 record_size;  /* sizeof(struct gpio_event) */
+};
+
+struct gpio_event {
+    __u64 ktime_ns;     /* CLOCK_MONOTONIC at the classifying edge */
+    __u32 seq;          /* per-line sequence number, gaps mean lost records */
+    __s32 count_after;  /* people count after this event was applied */
+    __u32 width_us;     /* measured pulse width */
+    __u16 line;         /* BCM line number */
+    __u8  symbol;       /* enum gpio_event_symbol */
+    __u8  flags;
+};
+
+static inline __s16 gpio_event_delta_entries(const struct gpio_event *ev) {
+    return (__s16)(ev->width_us & 0xFFFF);
+}
+
+static inline __s16 gpio_event_delta_exits(const struct gpio_event *ev) {
+    return (__s16)(ev->width_us >> 16);
+}
+
+// ---- MANCHESTER LINK ----
+//
+// A line whose sysfs "encoding" is "manchester" carries link_frame.h
+// frames at "bitrate" bit/s instead of width-coded pulses. On an output
+// line GPIO_IOCTL_TX_FRAME sends one frame, timed in the kernel, and
+// returns once it is on the wire. On an input line with the IRQ enabled,
+// EVENT frames update the count like pulses do, DELTA frames apply a whole
+// batch in one step and DATA frames are queued for GPIO_IOCTL_RX_FRAME
+// (-EAGAIN when empty).
+
+struct gpio_link_frame {
+    __u8 type;          /* enum link_frame_type */
+    __u8 seq;
+    __u8 len;           /* payload bytes, <= LINK_MAX_PAYLOAD */
+    __u8 reserved;
+    __u8 payload[64];
+};
+
+// ---- LOGIC-ANALYZER CAPTURE ----
+//
+// GPIO_IOCTL_LA_START allocates a ring of edge slots (power of two) for the
+// line and records every edge into it alongside normal counting. mmap()
+// of /dev/gpioN at offset 0 maps it read-only: one page holding struct
+// gpio_la_ctrl, then capacity struct gpio_la_edge slots from offset
+// PAGE_SIZE. The driver only ever advances head; slot (i & (capacity - 1))
+// holds edge i while head - i < capacity (edge head - capacity may already
+// be half overwritten by the edge being stored). Each consumer keeps its own
+// tail, loads head with acquire semantics, copies, then reloads head to
+// detect slots overwritten during the copy.
+
+#define GPIO_LA_MAGIC     0x4c414750u  /* "PGAL" little-endian */
+#define GPIO_LA_VERSION   1
+#define GPIO_LA_MIN_SLOTS 1024
+#define GPIO_LA_MAX_SLOTS (1u << 24)
+
+struct gpio_la_header {
+    __u32 magic;        /* GPIO_LA_MAGIC */
+    __u16 version;      /* GPIO_LA_VERSION */
+    __u16 record_size;  /* sizeof(struct gpio_la_edge) */
+};
+
+struct gpio_la_ctrl {
+    struct gpio_la_header hdr;
+    __u32 capacity;     /* slots, power of two */
+    __u16 line;
+    __u16 reserved;
+    __u32 head;         /* edges written since LA_START, wraps */
+    __u32 reserved2;
+};
+
+struct gpio_la_edge {
+    __u64 ktime_ns;
+    __u32 level;
+    __u32 reserved;
+};
+
+#ifndef __KERNEL__
+
+// ---- COUNT SERVER (rx -serve) ----
+//
+// Clients that only need the current value map the POSIX shared memory
+// object COUNT_SHM_NAME read-only and use count_snapshot_read(). Clients
+// that want every event connect to the Unix socket and receive the same
+// header + record stream that read() on the device produces.
+
+#define COUNT_SHM_NAME    "/sysprog_gpio_count"
+#define COUNT_SOCKET_PATH "/run/sysprog_gpio.sock"
+
+struct count_snapshot {
+    __u32 seq;          /* odd while the server is updating */
+    __s32 count;
+    __u64 last_event_ns;
+    __u64 events;
+    __u32 last_seq;
+    __u32 clients;
+};
+
+static inline void count_snapshot_read(const volatile struct count_snapshot *snap,
+                                       struct count_snapshot *out) {
+    __u32 seq;
+
+    do {
+        seq = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        out->count = snap->count;
+        out->last_event_ns = snap->last_event_ns;
+        out->events = snap->events;
+        out->last_seq = snap->last_seq;
+        out->clients = snap->clients;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&snap->seq, __ATOMIC_RELAXED));
+    out->seq = seq;
+}
+
+#endif /* !__KERNEL__ */
+
+#endif /* SYSPROG_GPIO_H */
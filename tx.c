@@ -7,15 +7,38 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/time.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "sysprog_gpio.h"
+#include "manchester.h"
 
 #define GPIO_PIN 26
 #define GPIO_BASE_PATH "/sys/class/sysprog_gpio"
 #define GPIO_EXPORT_PATH "/sys/class/sysprog_gpio/export"
 #define GPIO_UNEXPORT_PATH "/sys/class/sysprog_gpio/unexport"
 
+// 부하 생성 모드
+#define ENTRY_WIDTH_US   100000
+#define EXIT_WIDTH_US    200000
+#define PULSE_GAP_US     20000    // 펄스 사이 최소 LOW 구간
+#define MAX_PHASES       32
+
+#define BATCH_MAX_EVENTS 4096     // 한 DELTA 프레임에 묶는 최대 이벤트 수 (s16 범위 안)
+
 static volatile int running = 1;
-static char gpio_direction_path[64];
-static char gpio_value_path[64];
+static int gpio_value_fd = -1;
+static int link_fd = -1;             // 맨체스터 모드에서 /dev/gpioN
+static unsigned int link_bitrate = 0; // 0이면 폭 부호화 펄스
+static uint8_t link_seq = 0;
+static uint16_t delta_seq = 0;       // DELTA 프레임 전용 배치 번호
+static unsigned int batch_ms = 0;    // 0이면 이벤트마다 프레임 하나
+static const char *chip_path = NULL; // gpiochip 백엔드: count.ko 대신 uAPI v2 라인 요청
+static int chip_line = -1;
+static int chip_line_fd = -1;
 
 // 신호 핸들러
 void signal_handler(int sig) {
@@ -25,84 +48,143 @@ void signal_handler(int sig) {
     }
 }
 
+// sysfs 속성에 문자열 한 번 쓰기
+int sysfs_write(const char *path, const char *str) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return -1;
+    ssize_t n = write(fd, str, strlen(str));
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return n < 0 ? -1 : 0;
+}
+
+// gpiochip 라인을 출력(초기값 LOW)으로 요청
+int chip_init(void) {
+    struct gpio_v2_line_request req;
+    int chip_fd = open(chip_path, O_RDONLY | O_CLOEXEC);
+
+    if (chip_fd < 0) {
+        perror(chip_path);
+        return -1;
+    }
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = chip_line;
+    req.num_lines = 1;
+    strncpy(req.consumer, "sysprog-tx", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    req.config.num_attrs = 1;
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    req.config.attrs[0].attr.values = 0;
+    req.config.attrs[0].mask = 1;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        perror("ioctl - get line");
+        close(chip_fd);
+        return -1;
+    }
+    close(chip_fd);
+    chip_line_fd = req.fd;
+    printf("[TX] %s line %d requested as output\n", chip_path, chip_line);
+    return 0;
+}
+
 // GPIO 초기화
+// export 쓰기는 디바이스와 속성 파일이 모두 만들어진 뒤에 반환되므로
+// 대기나 재시도 없이 바로 direction/value를 열 수 있다.
 int gpio_init() {
-    FILE *export_file;
-    
-    // 먼저 기존에 export된 GPIO가 있는지 확인하고 unexport
-    snprintf(gpio_direction_path, sizeof(gpio_direction_path), 
-             "%s/gpio%d/direction", GPIO_BASE_PATH, GPIO_PIN);
-    
-    if (access(gpio_direction_path, F_OK) == 0) {
+    char path[64], pin[8];
+
+    if (chip_path)
+        return chip_init();
+
+    snprintf(pin, sizeof(pin), "%d", GPIO_PIN);
+    if (sysfs_write(GPIO_EXPORT_PATH, pin) == 0) {
+        printf("[TX] Exported GPIO %d to sysprog_gpio\n", GPIO_PIN);
+    } else if (errno == EBUSY) {
         printf("[TX] GPIO %d already exported in sysprog_gpio\n", GPIO_PIN);
     } else {
-        printf("[TX] Exporting GPIO %d to sysprog_gpio...\n", GPIO_PIN);
-        // GPIO export
-        export_file = fopen(GPIO_EXPORT_PATH, "w");
-        if (export_file == NULL) {
-            perror("fopen export");
-            return -1;
-        }
-        fprintf(export_file, "%d", GPIO_PIN);
-        fclose(export_file);
-        
-        // export 후 안정화 대기
-        usleep(500000); // 500ms 대기
+        perror("export");
+        return -1;
     }
-    
-    // 경로 설정
-    snprintf(gpio_direction_path, sizeof(gpio_direction_path), 
-             "%s/gpio%d/direction", GPIO_BASE_PATH, GPIO_PIN);
-    snprintf(gpio_value_path, sizeof(gpio_value_path), 
-             "%s/gpio%d/value", GPIO_BASE_PATH, GPIO_PIN);
-    
-    // export 후 안정화 대기
-    usleep(500000); // 500ms 대기
-    
-    // direction을 output으로 설정 (여러 번 시도)
-    int retry_count = 0;
-    while (retry_count < 5) {
-        FILE *direction_file = fopen(gpio_direction_path, "w");
-        if (direction_file != NULL) {
-            if (fprintf(direction_file, "out") > 0) {
-                fclose(direction_file);
-                break;
-            }
-            fclose(direction_file);
-        }
-        retry_count++;
-        printf("[TX] Retry setting direction (%d/5)...\n", retry_count);
-        usleep(200000); // 200ms 대기 후 재시도
+
+    snprintf(path, sizeof(path), "%s/gpio%d/direction", GPIO_BASE_PATH, GPIO_PIN);
+    if (sysfs_write(path, "out") < 0) {
+        perror("direction");
+        return -1;
     }
-    
-    if (retry_count >= 5) {
-        fprintf(stderr, "[TX] Failed to set GPIO direction after 5 attempts\n");
+
+    // value 파일은 열어 둔 채 pwrite로 갱신
+    snprintf(path, sizeof(path), "%s/gpio%d/value", GPIO_BASE_PATH, GPIO_PIN);
+    gpio_value_fd = open(path, O_WRONLY);
+    if (gpio_value_fd < 0) {
+        perror("open value");
         return -1;
     }
-    
+
+    // 맨체스터 모드: 선 부호화를 바꾸고 프레임은 드라이버가 hrtimer로 송신
+    if (link_bitrate) {
+        char rate[16];
+        snprintf(rate, sizeof(rate), "%u", link_bitrate);
+        snprintf(path, sizeof(path), "%s/gpio%d/bitrate", GPIO_BASE_PATH, GPIO_PIN);
+        if (sysfs_write(path, rate) < 0) {
+            perror("bitrate");
+            return -1;
+        }
+        snprintf(path, sizeof(path), "%s/gpio%d/encoding", GPIO_BASE_PATH, GPIO_PIN);
+        if (sysfs_write(path, "manchester") < 0) {
+            perror("encoding");
+            return -1;
+        }
+        snprintf(path, sizeof(path), "/dev/gpio%d", GPIO_PIN);
+        link_fd = open(path, O_RDWR);
+        if (link_fd < 0) {
+            perror("open link device");
+            return -1;
+        }
+        printf("[TX] Manchester link at %u bit/s\n", link_bitrate);
+    }
+
     printf("[TX] GPIO %d initialized as output\n", GPIO_PIN);
     return 0;
 }
 
 // GPIO 정리
 void gpio_cleanup() {
-    FILE *unexport_file = fopen(GPIO_UNEXPORT_PATH, "w");
-    if (unexport_file != NULL) {
-        fprintf(unexport_file, "%d", GPIO_PIN);
-        fclose(unexport_file);
-        printf("[TX] GPIO %d unexported\n", GPIO_PIN);
+    char pin[8];
+
+    if (chip_line_fd >= 0) {
+        close(chip_line_fd);
+        chip_line_fd = -1;
+        return;
+    }
+    if (link_fd >= 0) {
+        close(link_fd);
+        link_fd = -1;
     }
+    if (gpio_value_fd >= 0) {
+        close(gpio_value_fd);
+        gpio_value_fd = -1;
+    }
+    snprintf(pin, sizeof(pin), "%d", GPIO_PIN);
+    if (sysfs_write(GPIO_UNEXPORT_PATH, pin) == 0)
+        printf("[TX] GPIO %d unexported\n", GPIO_PIN);
 }
 
 // GPIO 값 설정
 int gpio_set_value(int value) {
-    FILE *value_file = fopen(gpio_value_path, "w");
-    if (value_file == NULL) {
-        perror("fopen value");
+    if (chip_line_fd >= 0) {
+        struct gpio_v2_line_values vals = { .bits = value ? 1 : 0, .mask = 1 };
+        if (ioctl(chip_line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &vals) < 0) {
+            perror("ioctl - set values");
+            return -1;
+        }
+        return 0;
+    }
+    if (pwrite(gpio_value_fd, value ? "1" : "0", 1, 0) < 0) {
+        perror("write value");
         return -1;
     }
-    fprintf(value_file, "%d", value);
-    fclose(value_file);
     return 0;
 }
 
@@ -114,8 +196,37 @@ void precise_usleep(int microseconds) {
     nanosleep(&req, &rem);
 }
 
+// EVENT 프레임 하나 송신 (선에 다 나간 뒤 반환)
+int send_event_frame(int symbol) {
+    struct gpio_link_frame f = { .type = LINK_FRAME_EVENT, .seq = link_seq++, .len = 1 };
+
+    f.payload[0] = symbol;
+    if (ioctl(link_fd, GPIO_IOCTL_TX_FRAME, &f) < 0) {
+        perror("ioctl - tx frame");
+        return -1;
+    }
+    return 0;
+}
+
+// 윈도우 동안 모은 입장/퇴장 수를 DELTA 프레임 하나로 송신
+int send_delta_frame(int entries, int exits) {
+    struct gpio_link_frame f = { .type = LINK_FRAME_DELTA, .seq = link_seq++, .len = LINK_DELTA_LEN };
+
+    link_delta_encode(f.payload, delta_seq++, entries, exits);
+    if (ioctl(link_fd, GPIO_IOCTL_TX_FRAME, &f) < 0) {
+        perror("ioctl - tx frame");
+        return -1;
+    }
+    return 0;
+}
+
 // 입장 신호 생성 (100ms 펄스)
 void send_entry_signal() {
+    if (link_fd >= 0) {
+        printf("[TX] Sending ENTRY frame...\n");
+        send_event_frame(GPIO_SYM_ENTRY);
+        return;
+    }
     printf("[TX] Sending ENTRY signal (100ms pulse)...\n");
     gpio_set_value(1);
     precise_usleep(100000); // 100ms
@@ -124,6 +235,11 @@ void send_entry_signal() {
 
 // 퇴장 신호 생성 (200ms 펄스)
 void send_exit_signal() {
+    if (link_fd >= 0) {
+        printf("[TX] Sending EXIT frame...\n");
+        send_event_frame(GPIO_SYM_EXIT);
+        return;
+    }
     printf("[TX] Sending EXIT signal (200ms pulse)...\n");
     gpio_set_value(1);
     precise_usleep(200000); // 200ms
@@ -187,16 +303,338 @@ void auto_test_mode() {
     printf("[TX] Auto test completed\n");
 }
 
+// ---- 시나리오 부하 생성 ----
+//
+// 단계(phase)마다 포아송 도착률, 입장 비율, 폭 지터, 버스트를 정해
+// 트래픽을 만든다. 펄스는 절대 시각(CLOCK_MONOTONIC) 기준으로 내보내므로
+// 로그 기록이나 스케줄 지연이 다음 펄스의 타이밍에 누적되지 않는다.
+// 선이 사용 중일 때 도착한 이벤트는 큐에 쌓였다가 순서대로 나간다.
+
+struct load_phase {
+    double rate;          // 초당 평균 도착 수
+    double duration;      // 초
+    double entry_ratio;   // 입장 비율 (0..1)
+    int jitter_us;        // 펄스 폭 지터 (±)
+    int burst_size;       // 버스트마다 추가되는 도착 수
+    double burst_every;   // 버스트 주기 (초, 0이면 없음)
+};
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t deadline) {
+    struct timespec ts = {
+        .tv_sec = deadline / 1000000000ull,
+        .tv_nsec = deadline % 1000000000ull,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && running)
+        ;
+}
+
+// 시나리오 파일: 한 줄에 한 단계
+//   rate duration entry_ratio jitter_us [burst_size burst_every]
+int load_scenario(const char *path, struct load_phase *phases) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    char line[256];
+    int n = 0;
+
+    if (f == NULL) {
+        perror("fopen scenario");
+        return -1;
+    }
+    while (n < MAX_PHASES && fgets(line, sizeof(line), f)) {
+        struct load_phase *p = &phases[n];
+        if (line[0] == '#' || line[strspn(line, " \t")] == '\n')
+            continue;
+        p->burst_size = 0;
+        p->burst_every = 0;
+        if (sscanf(line, "%lf %lf %lf %d %d %lf", &p->rate, &p->duration,
+                   &p->entry_ratio, &p->jitter_us, &p->burst_size, &p->burst_every) < 4 ||
+            p->rate <= 0 || p->duration <= 0) {
+            fprintf(stderr, "[TX] Bad scenario line: %s", line);
+            continue;
+        }
+        n++;
+    }
+    if (f != stdin)
+        fclose(f);
+    return n;
+}
+
+// 다음 도착 시각: 버스트가 남아 있으면 같은 시각, 아니면 지수 분포 간격
+static uint64_t next_arrival(const struct load_phase *p, uint64_t arrival,
+                             uint64_t *next_burst, int *pending_burst) {
+    if (*pending_burst > 0) {
+        (*pending_burst)--;
+        return arrival;
+    }
+    arrival += (uint64_t)(-log(1.0 - drand48()) / p->rate * 1e9);
+    if (*next_burst <= arrival) {
+        arrival = *next_burst;
+        *pending_burst = p->burst_size - 1;
+        *next_burst += (uint64_t)(p->burst_every * 1e9);
+    }
+    return arrival;
+}
+
+// 한 단계 실행. line_free는 선이 다시 비는 시각(ns)으로 단계 사이에 이어진다.
+void run_phase(int idx, const struct load_phase *p, uint64_t t0, uint64_t *line_free,
+               unsigned long *seq, FILE *seq_log) {
+    uint64_t start = *line_free > mono_ns() ? *line_free : mono_ns();
+    uint64_t end = start + (uint64_t)(p->duration * 1e9);
+    uint64_t arrival = start, next_burst = p->burst_every > 0 && p->burst_size > 0 ? start : UINT64_MAX;
+    unsigned long sent = 0, entries = 0, exits = 0;
+    uint64_t max_queue = 0, max_late = 0, queue_sum = 0;
+    int pending_burst = 0;
+
+    while (running) {
+        arrival = next_arrival(p, arrival, &next_burst, &pending_burst);
+        if (arrival >= end)
+            break;
+
+        int is_entry = drand48() < p->entry_ratio;
+        int width = is_entry ? ENTRY_WIDTH_US : EXIT_WIDTH_US;
+        if (p->jitter_us > 0)
+            width += (int)(drand48() * (2 * p->jitter_us + 1)) - p->jitter_us;
+
+        uint64_t rise = arrival > *line_free ? arrival : *line_free, fall, actual_rise, actual_fall;
+
+        if (link_fd >= 0) {
+            // 프레임 길이(뒤의 유휴 간격 포함)가 곧 선 점유 시간; 폭 열에는 프레임 시간(us)을 기록
+            uint64_t frame_ns = manch_frame_ns(link_bitrate, 1);
+            width = frame_ns / 1000;
+            fall = rise + frame_ns;
+            sleep_until_ns(rise);
+            actual_rise = mono_ns();
+            send_event_frame(is_entry ? GPIO_SYM_ENTRY : GPIO_SYM_EXIT);
+            actual_fall = mono_ns();
+            *line_free = actual_fall > fall ? actual_fall : fall;
+        } else {
+            fall = rise + (uint64_t)width * 1000;
+            sleep_until_ns(rise);
+            actual_rise = mono_ns();
+            gpio_set_value(1);
+            sleep_until_ns(fall);
+            actual_fall = mono_ns();
+            gpio_set_value(0);
+            *line_free = fall + PULSE_GAP_US * 1000ull;
+        }
+
+        uint64_t late = actual_fall > fall ? actual_fall - fall : 0;
+        if (late > max_late)
+            max_late = late;
+        if (rise - arrival > max_queue)
+            max_queue = rise - arrival;
+        queue_sum += rise - arrival;
+        sent++;
+        if (is_entry)
+            entries++;
+        else
+            exits++;
+
+        if (seq_log)
+            fprintf(seq_log, "%lu,%d,%s,%llu,%llu,%d,%llu,%llu\n", (*seq)++, idx,
+                    is_entry ? "ENTRY" : "EXIT",
+                    (unsigned long long)(arrival - t0), (unsigned long long)(rise - t0), width,
+                    (unsigned long long)(actual_rise - t0), (unsigned long long)(actual_fall - t0));
+    }
+
+    double elapsed = (mono_ns() - start) / 1e9;
+    printf("[TX] Phase %d: rate %.2f/s, sent %lu (entry %lu, exit %lu, net %+ld) in %.1f s = %.2f/s\n",
+           idx, p->rate, sent, entries, exits, (long)entries - (long)exits,
+           elapsed, elapsed > 0 ? sent / elapsed : 0.0);
+    printf("[TX]          queue delay avg %.1f ms max %.1f ms, edge lateness max %.3f ms\n",
+           sent ? queue_sum / 1e6 / sent : 0.0, max_queue / 1e6, max_late / 1e6);
+    fflush(stdout);
+}
+
+// 배치 모드 단계 실행: batch_ms 윈도우마다 도착한 이벤트를 모아 윈도우가
+// 닫힐 때 DELTA 프레임 하나로 보낸다. 선 점유는 사람 수가 아니라 프레임
+// 수에 비례한다. 로그에는 이벤트마다 한 줄씩, 실린 프레임의 시각으로 남긴다.
+void run_phase_batched(int idx, const struct load_phase *p, uint64_t t0, uint64_t *line_free,
+                       unsigned long *seq, FILE *seq_log) {
+    static struct { uint64_t arrival; int is_entry; } pending[BATCH_MAX_EVENTS];
+    uint64_t start = *line_free > mono_ns() ? *line_free : mono_ns();
+    uint64_t end = start + (uint64_t)(p->duration * 1e9);
+    uint64_t arrival = start, next_burst = p->burst_every > 0 && p->burst_size > 0 ? start : UINT64_MAX;
+    uint64_t window_ns = batch_ms * 1000000ull, window_end = start + window_ns;
+    uint64_t frame_ns = manch_frame_ns(link_bitrate, LINK_DELTA_LEN);
+    unsigned long sent = 0, entries = 0, exits = 0, frames = 0;
+    uint64_t max_queue = 0, max_late = 0, queue_sum = 0, busy_ns = 0;
+    int npending = 0, pending_burst = 0;
+
+    for (;;) {
+        int done = !running;
+        if (!done) {
+            arrival = next_arrival(p, arrival, &next_burst, &pending_burst);
+            done = arrival >= end;
+        }
+
+        if (npending > 0 && (done || arrival >= window_end || npending == BATCH_MAX_EVENTS)) {
+            uint64_t rise = window_end > *line_free ? window_end : *line_free;
+            int ne = 0, nx = 0;
+
+            for (int i = 0; i < npending; i++) {
+                if (pending[i].is_entry)
+                    ne++;
+                else
+                    nx++;
+            }
+            sleep_until_ns(rise);
+            uint64_t actual_rise = mono_ns();
+            send_delta_frame(ne, nx);
+            uint64_t actual_fall = mono_ns();
+            uint64_t fall = rise + frame_ns;
+            *line_free = actual_fall > fall ? actual_fall : fall;
+            busy_ns += frame_ns;
+
+            uint64_t late = actual_fall > fall ? actual_fall - fall : 0;
+            if (late > max_late)
+                max_late = late;
+            for (int i = 0; i < npending; i++) {
+                uint64_t queued = rise - pending[i].arrival;
+                if (queued > max_queue)
+                    max_queue = queued;
+                queue_sum += queued;
+                if (seq_log)
+                    fprintf(seq_log, "%lu,%d,%s,%llu,%llu,%llu,%llu,%llu\n", (*seq)++, idx,
+                            pending[i].is_entry ? "ENTRY" : "EXIT",
+                            (unsigned long long)(pending[i].arrival - t0),
+                            (unsigned long long)(rise - t0), (unsigned long long)(frame_ns / 1000),
+                            (unsigned long long)(actual_rise - t0), (unsigned long long)(actual_fall - t0));
+            }
+            sent += npending;
+            entries += ne;
+            exits += nx;
+            frames++;
+            npending = 0;
+        }
+        if (done)
+            break;
+
+        while (window_end <= arrival)
+            window_end += window_ns;
+        pending[npending].arrival = arrival;
+        pending[npending].is_entry = drand48() < p->entry_ratio;
+        npending++;
+    }
+
+    double elapsed = (mono_ns() - start) / 1e9;
+    printf("[TX] Phase %d: rate %.2f/s, sent %lu (entry %lu, exit %lu, net %+ld) in %lu frames, %.1f s = %.2f/s\n",
+           idx, p->rate, sent, entries, exits, (long)entries - (long)exits, frames,
+           elapsed, elapsed > 0 ? sent / elapsed : 0.0);
+    printf("[TX]          %.1f events/frame, line busy %.2f%%, queue delay avg %.1f ms max %.1f ms, "
+           "frame lateness max %.3f ms\n",
+           frames ? (double)sent / frames : 0.0, elapsed > 0 ? busy_ns / 1e7 / elapsed : 0.0,
+           sent ? queue_sum / 1e6 / sent : 0.0, max_queue / 1e6, max_late / 1e6);
+    fflush(stdout);
+}
+
+void load_mode(struct load_phase *phases, int nphases, const char *log_path) {
+    FILE *seq_log = NULL;
+    unsigned long seq = 0;
+    uint64_t t0 = mono_ns(), line_free = t0;
+
+    if (log_path) {
+        seq_log = fopen(log_path, "w");
+        if (seq_log == NULL) {
+            perror("fopen log");
+            return;
+        }
+        // 하네스가 수신측 기록과 비교할 의도된 시퀀스 (시각은 시작 기준 ns)
+        fprintf(seq_log, "seq,phase,symbol,arrival_ns,start_ns,width_us,actual_start_ns,actual_end_ns\n");
+    }
+
+    printf("\n=== Load Mode (%d phases) ===\n", nphases);
+    for (int i = 0; i < nphases && running; i++) {
+        if (batch_ms)
+            run_phase_batched(i, &phases[i], t0, &line_free, &seq, seq_log);
+        else
+            run_phase(i, &phases[i], t0, &line_free, &seq, seq_log);
+    }
+
+    if (seq_log)
+        fclose(seq_log);
+    printf("[TX] Load test completed (%lu events)\n", seq);
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s [-auto | -load SCENARIO | -rate R -duration S [-mix P] [-jitter US]\n"
+           "          [-burst N -burst-every S]] [-log FILE] [-seed N]\n"
+           "          [-manchester BITRATE [-batch-ms MS] | -chip /dev/gpiochipN -line N]\n", prog);
+    printf("  SCENARIO lines: rate duration entry_ratio jitter_us [burst_size burst_every]\n");
+    printf("  -manchester BITRATE  send events as link frames (%d..%d bit/s) instead of pulses\n",
+           MANCH_MIN_BITRATE, MANCH_MAX_BITRATE);
+    printf("  -batch-ms MS         load mode: one DELTA frame per MS window instead of a frame per event\n");
+    printf("  -chip PATH -line N   drive a GPIO character-device line instead of count.ko\n");
+}
+
 int main(int argc, char *argv[]) {
     int auto_mode = 0;
+    struct load_phase phases[MAX_PHASES];
+    struct load_phase single = { 0, 60, 0.5, 0, 0, 0 };
+    const char *scenario = NULL, *log_path = NULL;
+    int nphases = 0;
+    long seed = time(NULL);
     
     // 명령행 인수 처리
-    if (argc > 1 && strcmp(argv[1], "-auto") == 0) {
-        auto_mode = 1;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "-auto") == 0) {
+            auto_mode = 1;
+            continue;
+        }
+        if (val == NULL) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "-load") == 0) scenario = val;
+        else if (strcmp(arg, "-log") == 0) log_path = val;
+        else if (strcmp(arg, "-seed") == 0) seed = atol(val);
+        else if (strcmp(arg, "-rate") == 0) single.rate = atof(val);
+        else if (strcmp(arg, "-duration") == 0) single.duration = atof(val);
+        else if (strcmp(arg, "-mix") == 0) single.entry_ratio = atof(val);
+        else if (strcmp(arg, "-jitter") == 0) single.jitter_us = atoi(val);
+        else if (strcmp(arg, "-burst") == 0) single.burst_size = atoi(val);
+        else if (strcmp(arg, "-burst-every") == 0) single.burst_every = atof(val);
+        else if (strcmp(arg, "-manchester") == 0) link_bitrate = atoi(val);
+        else if (strcmp(arg, "-batch-ms") == 0) batch_ms = atoi(val);
+        else if (strcmp(arg, "-chip") == 0) chip_path = val;
+        else if (strcmp(arg, "-line") == 0) chip_line = atoi(val);
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if ((link_bitrate && (link_bitrate < MANCH_MIN_BITRATE || link_bitrate > MANCH_MAX_BITRATE)) ||
+        (batch_ms && !link_bitrate) || (chip_path && (chip_line < 0 || link_bitrate))) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (scenario) {
+        nphases = load_scenario(scenario, phases);
+        if (nphases <= 0) {
+            fprintf(stderr, "[TX] No usable phases in %s\n", scenario);
+            return 1;
+        }
+    } else if (single.rate > 0) {
+        phases[0] = single;
+        nphases = 1;
     }
+    srand48(seed);
     
     printf("[TX] People Counter Signal Transmitter\n");
-    printf("[TX] GPIO Pin: %d\n", GPIO_PIN);
+    if (chip_path)
+        printf("[TX] Line: %s offset %d\n", chip_path, chip_line);
+    else
+        printf("[TX] GPIO Pin: %d\n", GPIO_PIN);
     
     // 신호 핸들러 등록
     signal(SIGINT, signal_handler);
@@ -211,7 +649,10 @@ int main(int argc, char *argv[]) {
     // 초기 상태를 LOW로 설정
     gpio_set_value(0);
     
-    if (auto_mode) {
+    if (nphases > 0) {
+        printf("[TX] Random seed: %ld\n", seed);
+        load_mode(phases, nphases, log_path);
+    } else if (auto_mode) {
         auto_test_mode();
     } else {
         interactive_mode();
@@ -6,20 +6,47 @@
 #include <time.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include "sysprog_gpio.h"
+#include "link_frame.h"
+#include "manchester.h"
 
 // GPIO device paths
 #define GPIO_TX_DATA "/sys/class/password_gpio/gpio26/value"
 #define GPIO_TX_CLK  "/sys/class/password_gpio/gpio27/value"
+#define GPIO_TX_DATA_DIR "/sys/class/password_gpio/gpio26/direction"
+#define GPIO_TX_CLK_DIR  "/sys/class/password_gpio/gpio27/direction"
+#define GPIO_EXPORT      "/sys/class/password_gpio/export"
+
+// Single-wire alternative: Manchester frames on a count.ko line, no clock
+#define LINK_EXPORT      "/sys/class/sysprog_gpio/export"
+#define LINK_DIR         "/sys/class/sysprog_gpio/gpio26/direction"
+#define LINK_ENCODING    "/sys/class/sysprog_gpio/gpio26/encoding"
+#define LINK_BITRATE     "/sys/class/sysprog_gpio/gpio26/bitrate"
+#define LINK_DEV         "/dev/gpio26"
 
 // Transmission settings
-#define BIT_DELAY_US 50000    // 50ms
-#define SETUP_TIME_US 5000    // Data setup time
+#define BIT_DELAY_US 50000    // 50ms bit period
+#define SETUP_TIME_US 5000    // Data setup time before the clock rises
+#define PROGRESS_REFRESH_US 100000
 #define LOCK_DURATION 30
 #define MAX_FAIL 5
 
-int fd_data, fd_clk;
-int total_sent = 0;
-int transmission_progress = 0;
+int fd_data = -1, fd_clk = -1;
+int link_fd = -1;
+unsigned int link_bitrate = 0;
+int bit_us = BIT_DELAY_US;
+uint8_t frame_seq = 0;
+
+// Shared with the progress thread; only the bit loop writes them.
+volatile unsigned long total_sent = 0;
+volatile unsigned long progress_done = 0, progress_total = 0;
+volatile int progress_running = 0;
+const char *progress_label = "";
+uint64_t bit_deadline_ns = 0;
 
 // Color definitions
 #define COLOR_RESET     "\033[0m"
@@ -55,6 +82,16 @@ void show_progress(int current, int total, const char* message) {
     fflush(stdout);
 }
 
+int sysfs_write(const char *path, const char *str) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return -1;
+    ssize_t n = write(fd, str, strlen(str));
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return n < 0 ? -1 : 0;
+}
+
 void write_gpio_value(int fd, int value) {
     const char *val = value ? "1" : "0";
     lseek(fd, 0, SEEK_SET);
@@ -63,57 +100,226 @@ void write_gpio_value(int fd, int value) {
     }
 }
 
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void wait_until_ns(uint64_t deadline) {
+    struct timespec ts = { deadline / 1000000000ull, deadline % 1000000000ull };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+// One bit per bit_us, scheduled on absolute deadlines so consecutive bits
+// and frames follow each other without drift or extra gaps.
 void send_bit(int bit) {
-    total_sent++;
-    
-    // Data setup
+    uint64_t start = bit_deadline_ns;
+
+    wait_until_ns(start);
     write_gpio_value(fd_data, bit);
-    usleep(SETUP_TIME_US);
-    
-    // Clock pulse
+    wait_until_ns(start + SETUP_TIME_US * 1000ull);
     write_gpio_value(fd_clk, 1);
-    usleep(BIT_DELAY_US / 2);
+    wait_until_ns(start + (SETUP_TIME_US + bit_us / 2) * 1000ull);
     write_gpio_value(fd_clk, 0);
-    usleep(BIT_DELAY_US / 2);
+
+    bit_deadline_ns = start + bit_us * 1000ull;
+    total_sent++;
+    progress_done++;
 }
 
-void send_start_sequence() {
-    printf(COLOR_YELLOW "\n🚀 Sending start sequence...\n" COLOR_RESET);
-    unsigned char start_byte = 0xAA; // 10101010
-    
-    for (int i = 7; i >= 0; --i) {
-        int bit = (start_byte >> i) & 1;
-        send_bit(bit);
-        show_progress(7-i+1, 8, "Start Signal");
-        usleep(10000);
+void send_frame_bytes(const uint8_t *frame, int len) {
+    uint64_t now = mono_ns();
+
+    if (bit_deadline_ns < now)
+        bit_deadline_ns = now;
+    for (int i = 0; i < len; i++) {
+        for (int b = 7; b >= 0; --b)
+            send_bit((frame[i] >> b) & 1);
     }
-    printf(COLOR_GREEN "\n✅ Start sequence sent successfully!\n" COLOR_RESET);
 }
 
-void send_password(const char* password) {
-    printf(COLOR_CYAN "\n📤 Transmitting password: '%s'\n" COLOR_RESET);
+// The driver clocks the frame out itself and returns once it is sent.
+int send_link_frame(const uint8_t *payload, int len) {
+    struct gpio_link_frame f = { .type = LINK_FRAME_DATA, .seq = frame_seq++, .len = len };
+
+    memcpy(f.payload, payload, len);
+    if (ioctl(link_fd, GPIO_IOCTL_TX_FRAME, &f) < 0) {
+        printf(COLOR_RED "\n❌ Frame send error: %s\n" COLOR_RESET, strerror(errno));
+        return -1;
+    }
+    total_sent += (len + LINK_OVERHEAD) * 8;
+    progress_done += (len + LINK_OVERHEAD) * 8;
+    return len + LINK_OVERHEAD;
+}
+
+int send_data_frame(const uint8_t *payload, int len) {
+    uint8_t frame[LINK_MAX_FRAME];
+    int n;
+
+    if (len > LINK_MAX_PAYLOAD)
+        return -1;
+    if (link_fd >= 0)
+        return send_link_frame(payload, len);
+    n = link_frame_encode(frame, LINK_FRAME_DATA, frame_seq++, payload, len);
+    send_frame_bytes(frame, n);
+    return n;
+}
+
+// Exports GPIO 26 on sysprog_gpio as a Manchester output line.
+int link_init(void) {
+    char rate[16];
+
+    snprintf(rate, sizeof(rate), "%u", link_bitrate);
+    sysfs_write(LINK_EXPORT, "26");
+    if (sysfs_write(LINK_DIR, "out") < 0 || sysfs_write(LINK_BITRATE, rate) < 0 ||
+        sysfs_write(LINK_ENCODING, "manchester") < 0) {
+        printf(COLOR_RED "❌ Error: Cannot configure Manchester line: %s\n" COLOR_RESET, strerror(errno));
+        return -1;
+    }
+    link_fd = open(LINK_DEV, O_RDWR);
+    if (link_fd < 0) {
+        printf(COLOR_RED "❌ Error: Cannot open %s: %s\n" COLOR_RESET, LINK_DEV, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Data + clock lines on password_gpio.
+int clocked_init(void) {
+    // GPIO setup (already-exported pins report EBUSY and are fine)
+    sysfs_write(GPIO_EXPORT, "26");
+    sysfs_write(GPIO_EXPORT, "27");
+    if (sysfs_write(GPIO_TX_DATA_DIR, "out") < 0 || sysfs_write(GPIO_TX_CLK_DIR, "out") < 0) {
+        printf(COLOR_RED "❌ Error: Cannot set GPIO direction: %s\n" COLOR_RESET, strerror(errno));
+        return -1;
+    }
     
-    int total_bits = 32; // 4 characters * 8 bits
-    int bit_count = 0;
+    // GPIO file opening
+    fd_data = open(GPIO_TX_DATA, O_WRONLY);
+    if (fd_data < 0) {
+        printf(COLOR_RED "❌ Error: Cannot open data GPIO (%s)\n" COLOR_RESET, GPIO_TX_DATA);
+        return -1;
+    }
     
-    for (int i = 0; i < 4; ++i) {
-        unsigned char ch = password[i];
-        printf(COLOR_WHITE "Sending character '%c' (0x%02X): ", ch, ch);
-        
-        for (int b = 7; b >= 0; --b) {
-            int bit = (ch >> b) & 1;
-            send_bit(bit);
-            bit_count++;
-            
-            // Real-time progress update
-            show_progress(bit_count, total_bits, "Password");
-            usleep(5000);
-        }
-        printf(COLOR_GREEN " ✓\n" COLOR_RESET);
+    fd_clk = open(GPIO_TX_CLK, O_WRONLY);
+    if (fd_clk < 0) {
+        printf(COLOR_RED "❌ Error: Cannot open clock GPIO (%s)\n" COLOR_RESET, GPIO_TX_CLK);
+        close(fd_data);
+        return -1;
     }
+    
+    // Initial state setup
+    write_gpio_value(fd_data, 0);
+    write_gpio_value(fd_clk, 0);
+    return 0;
+}
+
+// Returns both lines low and closes whichever transport is open.
+void gpio_close(void) {
+    if (link_fd >= 0) {
+        close(link_fd);
+        return;
+    }
+    write_gpio_value(fd_data, 0);
+    write_gpio_value(fd_clk, 0);
+    close(fd_data);
+    close(fd_clk);
+}
+
+// Redraws the progress bar at a fixed rate, away from the bit timing.
+void *progress_thread(void *arg) {
+    (void)arg;
+    do {
+        if (progress_total)
+            show_progress(progress_done, progress_total, progress_label);
+        else
+            fprintf(stderr, "\r%s sent: %lu", progress_label, progress_done);
+        usleep(PROGRESS_REFRESH_US);
+    } while (progress_running);
+    return NULL;
+}
+
+void progress_start(pthread_t *tid, const char *label, unsigned long total_bits) {
+    progress_label = label;
+    progress_done = 0;
+    progress_total = total_bits;
+    progress_running = 1;
+    pthread_create(tid, NULL, progress_thread, NULL);
+}
+
+void progress_stop(pthread_t tid) {
+    progress_running = 0;
+    pthread_join(tid, NULL);
+}
+
+void send_password(const char* password) {
+    pthread_t tid;
+    int len = strlen(password);
+
+    printf(COLOR_CYAN "\n📤 Transmitting password: '%s' (seq %u)\n" COLOR_RESET, password, frame_seq);
+    progress_start(&tid, "Password frame", (len + LINK_OVERHEAD) * 8);
+    send_data_frame((const uint8_t *)password, len);
+    progress_stop(tid);
     printf(COLOR_GREEN "\n🎯 Password transmission complete!\n" COLOR_RESET);
 }
 
+// Streams one DATA frame per input line, back to back. Lines longer than
+// a frame payload are reported and skipped whole rather than split.
+int batch_mode(const char *path) {
+    FILE *in = path ? fopen(path, "r") : stdin;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    unsigned long frames = 0, bytes = 0, lineno = 0, rejected = 0, failed = 0;
+    pthread_t tid;
+
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    if (link_fd >= 0)
+        fprintf(stderr, "Streaming frames from %s (Manchester, %u bit/s)\n", path ? path : "stdin", link_bitrate);
+    else
+        fprintf(stderr, "Streaming frames from %s (bit period %d us)\n", path ? path : "stdin", bit_us);
+    progress_start(&tid, "Bits", 0);
+    uint64_t start = mono_ns();
+    while ((n = getline(&line, &cap, in)) >= 0) {
+        lineno++;
+        if (n > 0 && line[n - 1] == '\n')
+            n--;
+        if (n > LINK_MAX_PAYLOAD) {
+            fprintf(stderr, "\nLine %lu: %zd bytes exceeds the %d-byte frame payload, skipped\n",
+                    lineno, n, LINK_MAX_PAYLOAD);
+            rejected++;
+            continue;
+        }
+        if (send_data_frame((const uint8_t *)line, n) < 0) {
+            fprintf(stderr, "\nLine %lu: send failed\n", lineno);
+            failed++;
+            continue;
+        }
+        frames++;
+        bytes += n;
+    }
+    double secs = (mono_ns() - start) / 1e9;
+    progress_stop(tid);
+    free(line);
+    if (in != stdin)
+        fclose(in);
+
+    printf("\nSent %lu frames (%lu payload bytes, %lu bits) in %.2f s: %.1f bit/s, %.2f frames/s\n",
+           frames, bytes, total_sent, secs, secs > 0 ? total_sent / secs : 0.0,
+           secs > 0 ? frames / secs : 0.0);
+    if (rejected)
+        fprintf(stderr, "%lu oversize lines skipped\n", rejected);
+    if (failed)
+        fprintf(stderr, "%lu frames failed to send\n", failed);
+    return rejected || failed ? 1 : 0;
+}
+
 void display_header() {
     clear_screen();
     printf(COLOR_BOLD COLOR_CYAN);
@@ -137,7 +343,7 @@ void display_status(int fail_count, time_t lock_until) {
     
     printf(COLOR_WHITE "Failed attempts: %d/%d\n", fail_count, MAX_FAIL);
     printf("Expected password: 1234\n");
-    printf("Total bits sent: %d\n" COLOR_RESET, total_sent);
+    printf("Total bits sent: %lu\n" COLOR_RESET, total_sent);
     printf("─────────────────────────────────────────────\n\n");
 }
 
@@ -149,35 +355,45 @@ void display_instructions() {
     printf("• Invalid input will send '0000' as dummy\n\n");
 }
 
-int main() {
-    display_header();
-    
-    printf(COLOR_CYAN "🔧 Initializing GPIO pins...\n" COLOR_RESET);
-    
-    // GPIO setup
-    system("echo '26' > /sys/class/password_gpio/export 2>/dev/null");
-    system("echo '27' > /sys/class/password_gpio/export 2>/dev/null");
-    system("echo 'out' > /sys/class/password_gpio/gpio26/direction");
-    system("echo 'out' > /sys/class/password_gpio/gpio27/direction");
-    
-    // GPIO file opening
-    fd_data = open(GPIO_TX_DATA, O_WRONLY);
-    if (fd_data < 0) {
-        printf(COLOR_RED "❌ Error: Cannot open data GPIO (%s)\n" COLOR_RESET, GPIO_TX_DATA);
+int main(int argc, char *argv[]) {
+    int batch = 0;
+    const char *batch_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-batch") == 0) {
+            batch = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                batch_path = argv[++i];
+        } else if (strcmp(argv[i], "-bit-us") == 0 && i + 1 < argc) {
+            bit_us = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-manchester") == 0 && i + 1 < argc) {
+            link_bitrate = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [-batch [FILE]] [-bit-us N | -manchester BITRATE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (link_bitrate && (link_bitrate < MANCH_MIN_BITRATE || link_bitrate > MANCH_MAX_BITRATE)) {
+        printf("Manchester bitrate must be %d..%d bit/s\n", MANCH_MIN_BITRATE, MANCH_MAX_BITRATE);
         return 1;
     }
+    if (bit_us < 2 * SETUP_TIME_US)
+        bit_us = 2 * SETUP_TIME_US;
+
+    if (!batch) {
+        display_header();
+        printf(COLOR_CYAN "🔧 Initializing GPIO pins...\n" COLOR_RESET);
+    }
     
-    fd_clk = open(GPIO_TX_CLK, O_WRONLY);
-    if (fd_clk < 0) {
-        printf(COLOR_RED "❌ Error: Cannot open clock GPIO (%s)\n" COLOR_RESET, GPIO_TX_CLK);
-        close(fd_data);
+    if ((link_bitrate ? link_init() : clocked_init()) < 0)
         return 1;
+
+    if (batch) {
+        int ret = batch_mode(batch_path);
+        gpio_close();
+        return ret;
     }
-    
-    // Initial state setup
-    write_gpio_value(fd_data, 0);
-    write_gpio_value(fd_clk, 0);
-    
+
     printf(COLOR_GREEN "✅ GPIO initialized successfully!\n" COLOR_RESET);
     sleep(1);
     
@@ -228,12 +444,10 @@ int main() {
         }
         
         // Start transmission
-        printf(COLOR_BOLD COLOR_MAGENTA "\n" "="*60 "\n");
+        printf(COLOR_BOLD COLOR_MAGENTA "\n============================================================\n");
         printf("🎯 STARTING TRANSMISSION\n");
-        printf("="*60 "\n" COLOR_RESET);
+        printf("============================================================\n" COLOR_RESET);
         
-        send_start_sequence();
-        sleep(1);
         send_password(to_send);
         
         // Result processing
@@ -260,10 +474,7 @@ int main() {
     }
     
     // Cleanup
-    write_gpio_value(fd_data, 0);
-    write_gpio_value(fd_clk, 0);
-    close(fd_data);
-    close(fd_clk);
+    gpio_close();
     
     printf(COLOR_GREEN "\n✨ Thank you for using Password Transmitter!\n" COLOR_RESET);
     return 0;